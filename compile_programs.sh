@@ -4,19 +4,22 @@
 
 # 1. program to generate data for preferential attachment test
 cd patestgen
-g++ -o ptg patest_gen.c edgeheap.cpp edges.c idlist.cpp -O3 -march=native -lm -std=gnu++14
+g++ -o ptg patest_gen.c checkpoint.cpp edgeheap.cpp edgequeue.cpp edges.c idcache.cpp idlist.cpp nodedeg.cpp edgeef.cpp -I../patestrun -O3 -march=native -lm -lz -llzma -std=gnu++14 -pthread
+# same with 64-bit node IDs (only needed if the IDs do not fit in 32 bits, uses more memory)
+g++ -o ptg64 -DPTG_ID64 patest_gen.c checkpoint.cpp edgeheap.cpp edgequeue.cpp edges.c idcache.cpp idlist.cpp nodedeg.cpp edgeef.cpp -I../patestrun -O3 -march=native -lm -lz -llzma -std=gnu++14 -pthread
 cd ..
 
 # 2. programs to calculate test statistics
 cd patestrun
-g++ -o ptr patest_ranks.cpp -O3 -march=native -std=gnu++14
-g++ -o ptb patest_balances.cpp -O3 -march=native -lm -std=gnu++14
+g++ -o ptr patest_ranks.cpp -O3 -march=native -lz -std=gnu++14 -pthread
+g++ -o ptb patest_balances.cpp -O3 -march=native -lm -lz -llzma -std=gnu++14 -pthread
 cd ..
 
 # 3. helper code used to preprocess data and to create degree and balance distributions
 cd misc
 g++ -o numjoin numeric_join.cpp -O3 -march=native -std=gnu++11
 g++ -o indeg_dist indeg_dist_new.cpp -O3 -march=native -std=gnu++11
-g++ -o bdist balance_dists.cpp -O3 -march=native -std=gnu++11
+g++ -o bdist balance_dists.cpp -O3 -march=native -lz -llzma -std=gnu++11 -pthread
+g++ -o etsbin edges_ts_bin.cpp -O3 -march=native -lz -llzma -std=gnu++11 -pthread
 cd ..
 
@@ -45,6 +45,7 @@
 #include <unordered_map>
 
 #include "read_table.h"
+#include "zfile.h"
 
 
 struct record { //egy bejegyzés a bemeneti fájlokban (txint.txt és txoutt.txt)
@@ -77,9 +78,6 @@ bool read_out(read_table2& rt, record& r) {
 
 
 static char gzip0[] = "/bin/gzip -c";
-static char zcat[] = "/bin/zcat";
-static char xzcat[] = "/usr/bin/xzcat";
-
 static int strtodint(char* a,unsigned int* delay) {
 	char* a1 = 0;
 	unsigned int delay2 = strtoul(a,&a1,10);
@@ -135,8 +133,6 @@ int main(int argc, char **argv)
 		
 	
 	time_t t1 = time(0);
-	bool in_zip = false; //bemeneti fájlok tömörítve
-	bool in_xz = false; //input compressed by xz
 	
 	/* write out balance distribution this often (default: 1 year) */
 	unsigned int interval = 31536000;
@@ -161,10 +157,9 @@ int main(int argc, char **argv)
 			i++;
 			break;
 		case 'Z':
-			in_zip = true;
-			break;
 		case 'X':
-			in_xz = true;
+			/* compressed input files (gzip or xz) are detected automatically
+			 * (see zfile.h), these options are kept for compatibility */
 			break;
 		case 't':
 			ftxtime = argv[i+1];
@@ -178,50 +173,17 @@ int main(int argc, char **argv)
 	
 	DENEXT = DE1;
 	
-	char* fntmp = 0;
-	if(in_zip || in_xz) {
-		unsigned int l1 = ftxin ? strlen(ftxin) : 0;
-		unsigned int l2 = ftxout ? strlen(ftxout) : 0;
-		unsigned int l3 = ftxtime ? strlen(ftxtime) : 0;
-		if(l2 > l1) l1 = l2;
-		if(l3 > l1) l1 = l3;
-		
-		if(l1) {
-			fntmp = (char*)malloc(sizeof(char)*(l1 + strlen(xzcat) + 4));
-			if(!fntmp) {
-				fprintf(stderr,"Nem sikerült memóriát lefoglalni!\n");
-				return 2;
-			}
-		}
-	}
-	
-	FILE* in = 0;
-	if(ftxin) {
-		if(in_zip || in_xz) {
-			sprintf(fntmp,"%s %s",in_xz ? xzcat : zcat,ftxin);
-			in = popen(fntmp,"r");
-		}
-		else in = fopen(ftxin,"r");
-	}
-	else in = stdin;
-	FILE* out = 0;
-	if(ftxout) {
-		if(in_zip || in_xz) {
-			sprintf(fntmp,"%s %s",in_xz ? xzcat : zcat,ftxout);
-			out = popen(fntmp,"r");
-		}
-		else out = fopen(ftxout,"r");
-	}
-	else out = stdin;
-	FILE* ftt = 0;
-	if(ftxtime) {
-		if(in_zip || in_xz) {
-			sprintf(fntmp,"%s %s",zcat,ftxtime);
-			ftt = popen(fntmp,"r");
-		}
+	/* input files are decompressed in separate threads if needed (see zfile.h) */
+	FILE* in = ftxin ? zfile_open(ftxin) : stdin;
+	FILE* out = ftxout ? zfile_open(ftxout) : stdin;
+	FILE* ftt = ftxtime ? zfile_open(ftxtime) : stdin;
+	if(!(in && out && ftt)) {
+		fprintf(stderr,"Error opening input files!\n");
+		if(in && in != stdin) fclose(in);
+		if(out && out != stdin) fclose(out);
+		if(ftt && ftt != stdin) fclose(ftt);
+		return 1;
 	}
-	else ftt = stdin;
-	if(fntmp) free(fntmp);
 	
 	size_t txin = 0;
 	size_t txout = 0;
@@ -330,18 +292,9 @@ int main(int argc, char **argv)
 		r = 1;
 	}
 	
-	if(in && in != stdin) {
-		if(in_zip || in_xz) pclose(in);
-		else fclose(in);
-	}
-	if(out && out != stdin) {
-		if(in_zip || in_xz) pclose(out);
-		else fclose(out);
-	}
-	if(ftt && ftt != stdin) {
-		if(in_zip || in_xz) pclose(ftt);
-		else fclose(ftt);
-	}
+	if(in && in != stdin) fclose(in);
+	if(out && out != stdin) fclose(out);
+	if(ftt && ftt != stdin) fclose(ftt);
 	
 	fprintf(stderr,"feldolgozott bemenetek: %lu, kimenetek: %lu\n",txin,txout);
 	time_t t2 = time(0);
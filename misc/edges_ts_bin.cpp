@@ -0,0 +1,162 @@
+/*
+ * edges_ts_bin.cpp -- convert the time-ordered list of transactions
+ * 	(edges_ts.dat, lines of sender, receiver, timestamp) to the binary
+ * 	input format of ptg (-b option)
+ *
+ * by default, the output is written as EVBIN_TX records (see evbin.h):
+ * sender, receiver and timestamp are delta-coded varints in chunks of 64k
+ * records, so the output is typically a fraction of the size of the
+ * uncompressed text, and ptg decodes it a lot faster than parsing the text;
+ * with the -r option, the records are written as 12-byte binary structs
+ * instead (the format ptg -b used originally, which it still accepts); these
+ * can only store 32-bit node IDs, lines with larger IDs are treated as invalid
+ * (EVBIN_TX records can store 64-bit IDs, these can be read by ptg64)
+ *
+ * options:
+ * 	-i fn	input file (default: stdin; compressed files are detected
+ * 		automatically, see zfile.h)
+ * 	-o fn	output file (default: stdout)
+ * 	-r	write raw 12-byte records
+ * 	-I	stop on invalid node IDs (e.g. -1 for unknown addresses) instead
+ * 		of skipping these lines (same as ptg -I)
+ * 	-D n	print progress after every n lines (default: 10M, 0: never)
+ *
+ * Copyright 2020 Daniel Kondor <kondor.dani@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of the  nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "read_table.h"
+#include "zfile.h"
+#include "evbin.h"
+
+int main(int argc, char **argv) {
+	const char* fin = 0;
+	const char* fout = 0;
+	bool raw = false;
+	bool ignore_invalid = true;
+	uint64_t DE1 = 10000000;
+
+	for(int i=1;i<argc;i++) {
+		if(argv[i][0] == '-') switch(argv[i][1]) {
+			case 'i':
+				fin = argv[i+1];
+				i++;
+				break;
+			case 'o':
+				fout = argv[i+1];
+				i++;
+				break;
+			case 'r':
+				raw = true;
+				break;
+			case 'I':
+				ignore_invalid = false;
+				break;
+			case 'D':
+				DE1 = strtoull(argv[i+1],0,10);
+				i++;
+				break;
+			default:
+				fprintf(stderr,"Unknown parameter: %s!\n",argv[i]);
+				break;
+		}
+		else fprintf(stderr,"Unknown parameter: %s!\n",argv[i]);
+	}
+
+	FILE* in = fin ? zfile_open(fin) : stdin;
+	if(!in) {
+		fprintf(stderr,"Error opening input file %s!\n",fin);
+		return 1;
+	}
+	FILE* out = fout ? fopen(fout,"w") : stdout;
+	if(!out) {
+		fprintf(stderr,"Error opening output file %s!\n",fout);
+		if(fin) fclose(in);
+		return 1;
+	}
+
+	evbin_writer w;
+	if(!raw && evbin_writer_open(&w,out,EVBIN_TX,0)) {
+		fprintf(stderr,"Error writing the output!\n");
+		if(fin) fclose(in);
+		if(fout) fclose(out);
+		return 1;
+	}
+
+	read_table2 rt(in);
+	rt.set_fn(fin ? fin : "<stdin>");
+	uint64_t n = 0, skipped = 0, unsorted = 0;
+	unsigned int last_ts = 0;
+	int r = 0;
+	while(rt.read_line()) {
+		uint64_t in, out1;
+		unsigned int ts;
+		if(!rt.read(in,out1)) {
+			if(ignore_invalid && rt.get_last_error() == T_OVERFLOW) { skipped++; continue; }
+			break;
+		}
+		if(!rt.read(ts)) break;
+		if(raw && (in > UINT32_MAX || out1 > UINT32_MAX)) {
+			if(ignore_invalid) { skipped++; continue; }
+			fprintf(stderr,"Node ID does not fit in the raw records in line %lu!\n",rt.get_line());
+			r = 1;
+			break;
+		}
+		if(ts < last_ts) unsorted++;
+		last_ts = ts;
+		if(raw) {
+			uint32_t rec[3] = {(uint32_t)in, (uint32_t)out1, ts}; /* sender, receiver, timestamp, as in ptg */
+			if(fwrite(rec,sizeof(rec),1,out) != 1) { r = 1; break; }
+		}
+		else if(evbin_write_tx(&w,in,out1,ts)) { r = 1; break; }
+		n++;
+		if(DE1 && n % DE1 == 0) fprintf(stderr,"%lu records written\n",n);
+	}
+	if(!r && rt.get_last_error() != T_EOF) {
+		rt.write_error(stderr);
+		r = 1;
+	}
+	if(!raw && evbin_writer_close(&w)) r = 1;
+	if(fout) { if(fclose(out)) r = 1; }
+	else if(fflush(out)) r = 1;
+	if(fin) fclose(in);
+
+	if(r) fprintf(stderr,"Error converting the input!\n");
+	else {
+		fprintf(stderr,"%lu records written, %lu lines with invalid IDs skipped\n",n,skipped);
+		if(unsorted) fprintf(stderr,"Warning: the input is not sorted by time (%lu records earlier than the previous one)!\n",unsorted);
+	}
+	return r;
+}
+
@@ -0,0 +1,583 @@
+/*  -*- C++ -*-
+ * evbin.h -- compact binary format for the event streams written by
+ * 	patest_gen.c (ptg) and patest_balances.cpp (ptb -g), used instead of
+ * 	formatting, compressing, decompressing and parsing text
+ *
+ * file layout (all integers in the headers are little-endian):
+ * 	file header (16 bytes): magic "PTEV", version (u16), kind (u16),
+ * 		flags (u32), reserved (u32)
+ * 	chunks, one after the other, each with a header (16 bytes):
+ * 		number of records (u32), size of payload in bytes (u32),
+ * 		base value (u64, the first timestamp / txid in the chunk)
+ * 		followed by the packed records
+ * 	index: for each chunk, its offset in the file (u64) and base value (u64)
+ * 	trailer (32 bytes): number of chunks (u64), offset of the index (u64),
+ * 		total number of records (u64), magic "PTEI" + 4 zero bytes
+ *
+ * records (kind == EVBIN_DEG, events from ptg):
+ * 	1 byte: type (bits 0-2), contract (bits 3-4), bit 5 set if the timestamp
+ * 		is the same as the previous one
+ * 	varint: degree
+ * 	zigzag varint: new degree - degree, only for type 6 (degree changed by
+ * 		more than one, written by ptg -K)
+ * 	varint: zigzag-encoded difference of the timestamp from the previous
+ * 		one (or the chunk base for the first record); omitted if bit 5 is set
+ * records (kind == EVBIN_BAL, events from ptb -g):
+ * 	zigzag varints: old balance, new balance - old balance, txid difference
+ * records (kind == EVBIN_TX, transactions read by ptg -b, see misc/edges_ts_bin.cpp):
+ * 	1 byte: bit 0 / 1 / 2 set if the sender / receiver / timestamp is the
+ * 		same as in the previous record
+ * 	zigzag varints: difference of the sender, the receiver and the timestamp
+ * 		from the previous record (the previous sender and receiver are 0 at
+ * 		the start of each chunk), each omitted if the corresponding bit is set
+ *
+ * chunks are decoded independently; the index and trailer are written
+ * at the end, so the writer does not need to seek (output can be a pipe);
+ * reading is done by mapping the whole file in memory, the pages after the
+ * current chunk are requested in advance (madvise(MADV_WILLNEED))
+ *
+ * note: copies of this file are in the patestgen, patestrun and misc
+ * directories, these should be kept in sync
+ *
+ * Copyright 2020 Daniel Kondor <kondor.dani@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of the  nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * example usage (reading):
+
+evbin_reader r;
+if(evbin_open(&r,fn,EVBIN_DEG)) { ... } // error opening file
+evbin_deg ev;
+int res;
+while((res = evbin_read_deg(&r,&ev)) == 0) {
+	... // do something with ev.type, ev.deg, ev.ts, ev.contract (and ev.deg2 if ev.type == 6)
+}
+if(res < 0) { ... } // input file is corrupt
+evbin_close(&r);
+
+ */
+
+#ifndef EVBIN_H
+#define EVBIN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* kind of records stored in a file */
+#define EVBIN_DEG 1 /* type, degree, timestamp, (contract) -- from ptg */
+#define EVBIN_BAL 2 /* old balance, new balance, txid -- from ptb -g */
+#define EVBIN_TX 3 /* sender, receiver, timestamp -- transactions, read by ptg -b */
+/* flags */
+#define EVBIN_CONTRACT 1 /* contract column is present */
+
+#define EVBIN_VERSION 1
+static const char evbin_magic[4] = {'P','T','E','V'};
+static const char evbin_index_magic[4] = {'P','T','E','I'};
+static const size_t evbin_header_size = 16;
+static const size_t evbin_chunk_header_size = 16;
+static const size_t evbin_trailer_size = 32;
+static const uint32_t evbin_chunk_records = 65536; /* maximum number of records in one chunk */
+static const size_t evbin_max_record = 32; /* maximum size of one encoded record */
+static const size_t evbin_readahead = 8388608; /* read ahead this many bytes when reading */
+
+/* one event from ptg */
+typedef struct evbin_deg_s {
+	unsigned int type;
+	unsigned int deg;
+	unsigned int ts;
+	int contract;
+	unsigned int deg2; /* new degree, only for type 6 */
+} evbin_deg;
+
+/* one event from ptb -g */
+typedef struct evbin_bal_s {
+	int64_t old_bal;
+	int64_t new_bal;
+	uint64_t txid;
+} evbin_bal;
+
+/* one transaction: sender, receiver (64-bit, so that ptg compiled with
+ * 64-bit node IDs can use the same files) and timestamp */
+typedef struct evbin_tx_s {
+	uint64_t in;
+	uint64_t out;
+	unsigned int ts;
+} evbin_tx;
+
+
+/* helpers for variable length encoding */
+static inline uint8_t* evbin_put_varint(uint8_t* p, uint64_t x) {
+	while(x >= 0x80) {
+		*p = (uint8_t)(x | 0x80);
+		p++;
+		x >>= 7;
+	}
+	*p = (uint8_t)x;
+	return p + 1;
+}
+static inline uint64_t evbin_zigzag(int64_t x) {
+	return (((uint64_t)x) << 1) ^ (uint64_t)(x >> 63);
+}
+static inline int64_t evbin_unzigzag(uint64_t x) {
+	return (int64_t)(x >> 1) ^ -(int64_t)(x & 1);
+}
+/* decode a varint, return NULL if it would go past end */
+static inline const uint8_t* evbin_get_varint(const uint8_t* p, const uint8_t* end, uint64_t* x) {
+	uint64_t r = 0;
+	unsigned int shift = 0;
+	while(p < end) {
+		uint8_t b = *p;
+		p++;
+		r |= ((uint64_t)(b & 0x7f)) << shift;
+		if(!(b & 0x80)) { *x = r; return p; }
+		shift += 7;
+		if(shift > 63) return 0;
+	}
+	return 0;
+}
+static inline void evbin_put_u32(uint8_t* p, uint32_t x) { memcpy(p,&x,4); }
+static inline void evbin_put_u64(uint8_t* p, uint64_t x) { memcpy(p,&x,8); }
+static inline uint32_t evbin_get_u32(const uint8_t* p) { uint32_t x; memcpy(&x,p,4); return x; }
+static inline uint64_t evbin_get_u64(const uint8_t* p) { uint64_t x; memcpy(&x,p,8); return x; }
+
+
+/************************************************************************
+ * writing                                                              *
+ ************************************************************************/
+
+typedef struct evbin_writer_s {
+	FILE* f; /* output -- not closed by evbin_writer_close() */
+	uint8_t* buf; /* current chunk (header + payload) */
+	size_t len; /* bytes used in buf (including the chunk header) */
+	uint32_t nrec; /* records in the current chunk */
+	uint64_t base; /* base value of the current chunk */
+	uint64_t last; /* previous timestamp / txid */
+	uint64_t last_in; /* previous sender and receiver (EVBIN_TX) */
+	uint64_t last_out;
+	uint64_t pos; /* offset of the current chunk in the output */
+	uint64_t total; /* number of records written */
+	uint64_t* idx; /* index: offset and base value for each chunk */
+	size_t nidx;
+	size_t idx_size;
+	uint16_t kind;
+	uint32_t flags;
+	int error;
+} evbin_writer;
+
+/* start writing to f -- returns 0 on success */
+static inline int evbin_writer_open(evbin_writer* w, FILE* f, uint16_t kind, uint32_t flags) {
+	memset(w,0,sizeof(evbin_writer));
+	if(!f) return 1;
+	w->f = f;
+	w->kind = kind;
+	w->flags = flags;
+	w->buf = (uint8_t*)malloc(evbin_chunk_header_size + evbin_chunk_records*evbin_max_record);
+	if(!w->buf) return 1;
+	w->len = evbin_chunk_header_size;
+	uint8_t header[16];
+	uint16_t version = EVBIN_VERSION;
+	memcpy(header,evbin_magic,4);
+	memcpy(header+4,&version,2);
+	memcpy(header+6,&kind,2);
+	evbin_put_u32(header+8,flags);
+	evbin_put_u32(header+12,0);
+	if(fwrite(header,evbin_header_size,1,f) != 1) { w->error = 1; return 1; }
+	w->pos = evbin_header_size;
+	return 0;
+}
+
+/* write out the current chunk */
+static inline int evbin_writer_flush(evbin_writer* w) {
+	if(!w->nrec) return w->error;
+	if(w->nidx == w->idx_size) {
+		size_t new_size = w->idx_size ? 2*w->idx_size : 1024;
+		uint64_t* tmp = (uint64_t*)realloc(w->idx, sizeof(uint64_t)*2*new_size);
+		if(!tmp) { w->error = 1; return 1; }
+		w->idx = tmp;
+		w->idx_size = new_size;
+	}
+	w->idx[2*w->nidx] = w->pos;
+	w->idx[2*w->nidx+1] = w->base;
+	w->nidx++;
+	evbin_put_u32(w->buf, w->nrec);
+	evbin_put_u32(w->buf + 4, (uint32_t)(w->len - evbin_chunk_header_size));
+	evbin_put_u64(w->buf + 8, w->base);
+	if(fwrite(w->buf,w->len,1,w->f) != 1) w->error = 1;
+	w->pos += w->len;
+	w->len = evbin_chunk_header_size;
+	w->nrec = 0;
+	return w->error;
+}
+
+/* start a new record with the given timestamp / txid */
+static inline int evbin_writer_next(evbin_writer* w, uint64_t base) {
+	if(w->nrec == evbin_chunk_records) if(evbin_writer_flush(w)) return 1;
+	if(!w->nrec) {
+		w->base = base;
+		w->last = base;
+		w->last_in = 0;
+		w->last_out = 0;
+	}
+	w->nrec++;
+	w->total++;
+	return 0;
+}
+
+static inline int evbin_write_deg(evbin_writer* w, unsigned int type, unsigned int deg, unsigned int ts, int contract,
+		unsigned int deg2 = 0) {
+	if(evbin_writer_next(w,ts)) return 1;
+	uint8_t* p = w->buf + w->len;
+	uint8_t b = (uint8_t)((type & 7) | ((contract & 3) << 3));
+	int64_t diff = (int64_t)ts - (int64_t)(w->last);
+	if(!diff) b |= 0x20;
+	*p = b;
+	p = evbin_put_varint(p+1, deg);
+	if(type == 6) p = evbin_put_varint(p, evbin_zigzag((int64_t)deg2 - (int64_t)deg));
+	if(diff) p = evbin_put_varint(p, evbin_zigzag(diff));
+	w->last = ts;
+	w->len = p - w->buf;
+	return 0;
+}
+
+static inline int evbin_write_bal(evbin_writer* w, int64_t old_bal, int64_t new_bal, uint64_t txid) {
+	if(evbin_writer_next(w,txid)) return 1;
+	uint8_t* p = w->buf + w->len;
+	p = evbin_put_varint(p, evbin_zigzag(old_bal));
+	p = evbin_put_varint(p, evbin_zigzag(new_bal - old_bal));
+	p = evbin_put_varint(p, evbin_zigzag((int64_t)(txid - w->last)));
+	w->last = txid;
+	w->len = p - w->buf;
+	return 0;
+}
+
+static inline int evbin_write_tx(evbin_writer* w, uint64_t in, uint64_t out, unsigned int ts) {
+	if(evbin_writer_next(w,ts)) return 1;
+	uint8_t* p0 = w->buf + w->len;
+	uint8_t* p = p0 + 1;
+	uint8_t b = 0;
+	if(in == w->last_in) b |= 1;
+	else p = evbin_put_varint(p, evbin_zigzag((int64_t)(in - w->last_in)));
+	if(out == w->last_out) b |= 2;
+	else p = evbin_put_varint(p, evbin_zigzag((int64_t)(out - w->last_out)));
+	if(ts == w->last) b |= 4;
+	else p = evbin_put_varint(p, evbin_zigzag((int64_t)ts - (int64_t)(w->last)));
+	*p0 = b;
+	w->last_in = in;
+	w->last_out = out;
+	w->last = ts;
+	w->len = p - w->buf;
+	return 0;
+}
+
+/* write any remaining data, the index and the trailer, free memory
+ * note: does not close the output file; returns nonzero if there was
+ * any error during writing */
+static inline int evbin_writer_close(evbin_writer* w) {
+	if(!w->f) return 1;
+	evbin_writer_flush(w);
+	if(!w->error && w->nidx && fwrite(w->idx,sizeof(uint64_t)*2,w->nidx,w->f) != w->nidx) w->error = 1;
+	uint8_t trailer[32];
+	evbin_put_u64(trailer, w->nidx);
+	evbin_put_u64(trailer+8, w->pos);
+	evbin_put_u64(trailer+16, w->total);
+	memcpy(trailer+24,evbin_index_magic,4);
+	evbin_put_u32(trailer+28,0);
+	if(!w->error && fwrite(trailer,evbin_trailer_size,1,w->f) != 1) w->error = 1;
+	if(fflush(w->f)) w->error = 1;
+	if(w->buf) free(w->buf);
+	if(w->idx) free(w->idx);
+	w->buf = 0;
+	w->idx = 0;
+	w->f = 0;
+	return w->error;
+}
+
+
+/************************************************************************
+ * reading                                                              *
+ ************************************************************************/
+
+typedef struct evbin_reader_s {
+	const uint8_t* map; /* the whole file */
+	size_t size;
+	const uint8_t* p; /* current position */
+	const uint8_t* chunk_end; /* end of the current chunk */
+	const uint8_t* data_end; /* end of the chunks (start of the index) */
+	const uint64_t* idx; /* index (NULL if the file has no trailer) */
+	uint64_t nchunks;
+	uint64_t total; /* number of records (if known from the trailer) */
+	uint32_t nleft; /* records left in the current chunk */
+	uint64_t last; /* previous timestamp / txid */
+	uint64_t last_in; /* previous sender and receiver (EVBIN_TX) */
+	uint64_t last_out;
+	const uint8_t* ra_end; /* end of the area already requested with MADV_WILLNEED */
+	uint16_t kind;
+	uint32_t flags;
+	int fd;
+} evbin_reader;
+
+/* open and map the given file; kind should be EVBIN_DEG, EVBIN_BAL or EVBIN_TX
+ * returns 0 on success */
+static inline int evbin_open(evbin_reader* r, const char* fn, uint16_t kind) {
+	memset(r,0,sizeof(evbin_reader));
+	r->fd = -1;
+	int fd = open(fn,O_RDONLY | O_CLOEXEC);
+	if(fd == -1) {
+		fprintf(stderr,"evbin_open(): error opening file %s!\n",fn);
+		return 1;
+	}
+	struct stat st;
+	if(fstat(fd,&st) == -1 || (size_t)st.st_size < evbin_header_size) {
+		fprintf(stderr,"evbin_open(): invalid input file %s!\n",fn);
+		close(fd);
+		return 1;
+	}
+	void* map = mmap(0,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+	if(map == MAP_FAILED) {
+		fprintf(stderr,"evbin_open(): error mapping file %s!\n",fn);
+		close(fd);
+		return 1;
+	}
+	madvise(map,st.st_size,MADV_SEQUENTIAL);
+	r->map = (const uint8_t*)map;
+	r->size = st.st_size;
+	r->fd = fd;
+	uint16_t version;
+	memcpy(&version,r->map+4,2);
+	memcpy(&(r->kind),r->map+6,2);
+	r->flags = evbin_get_u32(r->map+8);
+	if(memcmp(r->map,evbin_magic,4) || version != EVBIN_VERSION || r->kind != kind) {
+		fprintf(stderr,"evbin_open(): invalid file format or version in %s!\n",fn);
+		munmap(map,r->size);
+		close(fd);
+		r->map = 0;
+		r->fd = -1;
+		return 1;
+	}
+	r->p = r->map + evbin_header_size;
+	r->chunk_end = r->p;
+	r->ra_end = r->p;
+	r->data_end = r->map + r->size;
+	/* check for trailer and index */
+	if(r->size >= evbin_header_size + evbin_trailer_size) {
+		const uint8_t* t = r->map + r->size - evbin_trailer_size;
+		if(!memcmp(t+24,evbin_index_magic,4)) {
+			uint64_t nchunks = evbin_get_u64(t);
+			uint64_t idx_pos = evbin_get_u64(t+8);
+			if(idx_pos >= evbin_header_size && idx_pos + nchunks*2*sizeof(uint64_t) + evbin_trailer_size == r->size) {
+				r->nchunks = nchunks;
+				r->total = evbin_get_u64(t+16);
+				r->idx = (const uint64_t*)(r->map + idx_pos);
+				r->data_end = r->map + idx_pos;
+			}
+		}
+	}
+	/* note: if there is no (valid) trailer, reading continues as long as valid
+	 * chunks are found, e.g. if the writer was interrupted */
+	return 0;
+}
+
+static inline void evbin_close(evbin_reader* r) {
+	if(r->map) munmap((void*)(r->map),r->size);
+	if(r->fd >= 0) close(r->fd);
+	r->map = 0;
+	r->fd = -1;
+}
+
+/* go to the next chunk; returns 0 on success, 1 on end of data, -1 on error */
+static inline int evbin_next_chunk(evbin_reader* r) {
+	if(r->p != r->chunk_end) return -1; /* previous chunk was not processed fully */
+	if(r->p == r->data_end) return 1;
+	if((size_t)(r->data_end - r->p) < evbin_chunk_header_size) return r->idx ? -1 : 1;
+	uint32_t nrec = evbin_get_u32(r->p);
+	uint32_t len = evbin_get_u32(r->p+4);
+	if(!nrec || len > (size_t)(r->data_end - r->p) - evbin_chunk_header_size) return r->idx ? -1 : 1;
+	r->last = evbin_get_u64(r->p+8);
+	r->last_in = 0;
+	r->last_out = 0;
+	r->nleft = nrec;
+	r->p += evbin_chunk_header_size;
+	r->chunk_end = r->p + len;
+	/* read ahead: when less than half of the requested area is left */
+	if(r->ra_end < r->data_end && (r->ra_end <= r->chunk_end ||
+			(size_t)(r->ra_end - r->chunk_end) < evbin_readahead/2)) {
+		const uint8_t* start = r->chunk_end > r->ra_end ? r->chunk_end : r->ra_end;
+		const uint8_t* end = start + evbin_readahead;
+		if(end > r->data_end || end < start) end = r->data_end;
+		uintptr_t a = ((uintptr_t)start) & ~(uintptr_t)4095; /* madvise() needs an aligned address */
+		madvise((void*)a, end - (const uint8_t*)a, MADV_WILLNEED);
+		r->ra_end = end;
+	}
+	return 0;
+}
+
+/* read the next event; returns 0 on success, 1 on end of data, -1 on error */
+static inline int evbin_read_deg(evbin_reader* r, evbin_deg* ev) {
+	if(!r->nleft) {
+		int res = evbin_next_chunk(r);
+		if(res) return res;
+	}
+	const uint8_t* p = r->p;
+	if(p >= r->chunk_end) return -1;
+	uint8_t b = *p;
+	uint64_t deg, diff = 0, diff2 = 0;
+	p = evbin_get_varint(p+1, r->chunk_end, &deg);
+	if(!p) return -1;
+	if((b & 7) == 6) {
+		p = evbin_get_varint(p, r->chunk_end, &diff2);
+		if(!p) return -1;
+	}
+	if(!(b & 0x20)) {
+		p = evbin_get_varint(p, r->chunk_end, &diff);
+		if(!p) return -1;
+	}
+	r->last += evbin_unzigzag(diff);
+	ev->type = b & 7;
+	ev->contract = (b >> 3) & 3;
+	ev->deg = (unsigned int)deg;
+	ev->deg2 = (unsigned int)((int64_t)deg + evbin_unzigzag(diff2));
+	ev->ts = (unsigned int)(r->last);
+	r->p = p;
+	r->nleft--;
+	return 0;
+}
+
+static inline int evbin_read_bal(evbin_reader* r, evbin_bal* ev) {
+	if(!r->nleft) {
+		int res = evbin_next_chunk(r);
+		if(res) return res;
+	}
+	const uint8_t* p = r->p;
+	uint64_t x1, x2, x3;
+	p = evbin_get_varint(p, r->chunk_end, &x1);
+	if(p) p = evbin_get_varint(p, r->chunk_end, &x2);
+	if(p) p = evbin_get_varint(p, r->chunk_end, &x3);
+	if(!p) return -1;
+	ev->old_bal = evbin_unzigzag(x1);
+	ev->new_bal = ev->old_bal + evbin_unzigzag(x2);
+	r->last += (uint64_t)evbin_unzigzag(x3);
+	ev->txid = r->last;
+	r->p = p;
+	r->nleft--;
+	return 0;
+}
+
+static inline int evbin_read_tx(evbin_reader* r, evbin_tx* ev) {
+	if(!r->nleft) {
+		int res = evbin_next_chunk(r);
+		if(res) return res;
+	}
+	const uint8_t* p = r->p;
+	if(p >= r->chunk_end) return -1;
+	uint8_t b = *p;
+	uint64_t x;
+	p++;
+	if(!(b & 1)) {
+		p = evbin_get_varint(p, r->chunk_end, &x);
+		if(!p) return -1;
+		r->last_in += evbin_unzigzag(x);
+	}
+	if(!(b & 2)) {
+		p = evbin_get_varint(p, r->chunk_end, &x);
+		if(!p) return -1;
+		r->last_out += evbin_unzigzag(x);
+	}
+	if(!(b & 4)) {
+		p = evbin_get_varint(p, r->chunk_end, &x);
+		if(!p) return -1;
+		r->last += evbin_unzigzag(x);
+	}
+	ev->in = r->last_in;
+	ev->out = r->last_out;
+	ev->ts = (unsigned int)(r->last);
+	r->p = p;
+	r->nleft--;
+	return 0;
+}
+
+/* decode all records of the next chunk (or the rest of the current one) into buf,
+ * which should have space for evbin_chunk_records records; the number of
+ * records is stored in *n; returns 0 on success, 1 on end of data, -1 on error */
+static inline int evbin_read_tx_chunk(evbin_reader* r, evbin_tx* buf, uint32_t* n) {
+	*n = 0;
+	if(!r->nleft) {
+		int res = evbin_next_chunk(r);
+		if(res) return res;
+	}
+	uint32_t nrec = r->nleft;
+	for(uint32_t i=0;i<nrec;i++) if(evbin_read_tx(r,buf+i)) return -1;
+	*n = nrec;
+	return 0;
+}
+
+/* go to the n-th record of the file (counting from 0), so that the next
+ * read returns it; returns 0 on success, 1 if the file has less than n
+ * records, -1 on error */
+static inline int evbin_seek(evbin_reader* r, uint64_t n) {
+	r->p = r->map + evbin_header_size;
+	r->chunk_end = r->p;
+	r->nleft = 0;
+	while(n) {
+		int res = evbin_next_chunk(r);
+		if(res) return res;
+		if(n >= r->nleft) {
+			/* skip the whole chunk */
+			n -= r->nleft;
+			r->nleft = 0;
+			r->p = r->chunk_end;
+			continue;
+		}
+		for(; n; n--) {
+			evbin_deg ev1;
+			evbin_bal ev2;
+			evbin_tx ev3;
+			switch(r->kind) {
+				case EVBIN_DEG:
+					res = evbin_read_deg(r,&ev1);
+					break;
+				case EVBIN_BAL:
+					res = evbin_read_bal(r,&ev2);
+					break;
+				default:
+					res = evbin_read_tx(r,&ev3);
+					break;
+			}
+			if(res) return -1;
+		}
+	}
+	return 0;
+}
+
+#endif
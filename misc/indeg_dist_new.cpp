@@ -2,7 +2,10 @@
  * indeg_dist_new.cpp -- track an evolving network, write out the indegree
  * 	distributions at given intervals
  * 
- * use the output of the patest_gen.c program
+ * use the output of the patest_gen.c program, either as text from stdin,
+ * or from a binary file written by ptg -B (-b option); events of type 6
+ * (written by ptg -K) change the degree of a node to the new degree given
+ * after the degree in one step
  * 
  * Copyright 2020 Daniel Kondor <kondor.dani@gmail.com>
  * 
@@ -39,6 +42,7 @@
 #include <stdint.h>
 #include <map>
 #include "read_table.h"
+#include "evbin.h"
 
 template<class cont>
 void write_deg_dist(FILE* fout, const cont& deg_dist, unsigned int ts) {
@@ -82,6 +86,8 @@ int main(int argc, char **argv)
 	unsigned int interval = 31536000;
 	unsigned int tsnext = 0; /* starting time to write out distributions */
 	bool require_sorted = true;
+	const char* fbin = 0; /* read events from this binary file instead of stdin */
+	int contract_filter = -1; /* if >= 0, only use events with this value in the contract column */
 	for(int i = 1; i < argc; i++) if(argv[i][0] == '-') switch(argv[i][1]) {
 		case 'i':
 			if(strtodint(argv[i+1], &interval))
@@ -95,6 +101,14 @@ int main(int argc, char **argv)
 		case 'S':
 			require_sorted = false;
 			break;
+		case 'b':
+			fbin = argv[i+1];
+			i++;
+			break;
+		case 'C':
+			contract_filter = atoi(argv[i+1]);
+			i++;
+			break;
 		default:
 			fprintf(stderr, "Invalid value for time interval: %s!\n", argv[i+1]);
 			break;
@@ -104,12 +118,30 @@ int main(int argc, char **argv)
 	/* degree distribution -- note: we don't keep track of nodes with zero degree */
 	std::map<uint64_t, uint64_t> deg_dist;
 	read_table2 rt(stdin);
+	evbin_reader evr;
+	int evr_res = 0;
+	if(fbin && evbin_open(&evr,fbin,EVBIN_DEG)) return 1;
 	unsigned int ts = 0; /* current time */
 	bool first = true;
-	while(rt.read_line()) {
+	while(true) {
 		unsigned int type, ts1;
-		uint64_t deg;
-		if(!rt.read(type, deg, ts1)) break;
+		uint64_t deg, deg2 = 0;
+		if(fbin) {
+			evbin_deg ev;
+			evr_res = evbin_read_deg(&evr,&ev);
+			if(evr_res) break;
+			if(contract_filter >= 0 && ev.contract != contract_filter) continue;
+			type = ev.type;
+			deg = ev.deg;
+			deg2 = ev.deg2;
+			ts1 = ev.ts;
+		}
+		else {
+			if(!rt.read_line()) break;
+			if(!rt.read(type, deg)) break;
+			if(type == 6 && !rt.read(deg2)) break;
+			if(!rt.read(ts1)) break;
+		}
 		if(!tsnext) tsnext = ts1 + interval;
 		
 		if(require_sorted) {
@@ -133,6 +165,10 @@ int main(int argc, char **argv)
 			case 1:
 				next_deg = deg + 1;
 				break;
+			case 6:
+				/* degree changed by more than one */
+				next_deg = deg2;
+				break;
 			case 2:
 			case 3:
 			case 4:
@@ -151,7 +187,14 @@ int main(int argc, char **argv)
 			if(!res.second) res.first->second++;
 		}
 	}
-	if(rt.get_last_error() != T_EOF) {
+	if(fbin) {
+		evbin_close(&evr);
+		if(evr_res < 0) {
+			fprintf(stderr, "Error reading input file %s!\n", fbin);
+			return 1;
+		}
+	}
+	else if(rt.get_last_error() != T_EOF) {
 		rt.write_error(stderr);
 		return 1;
 	}
@@ -0,0 +1,394 @@
+/*  -*- C++ -*-
+ * zfile.h -- read compressed input files directly, without starting an
+ * 	external zcat / xzcat process
+ *
+ * zfile_open() detects the format of the file from its first bytes (gzip,
+ * xz, or zstd if compiled with -DZFILE_ZSTD) and returns a FILE* that gives
+ * the decompressed contents, so it can be used with read_table, fread(),
+ * etc. the same way as a FILE* from popen(); uncompressed files are simply
+ * opened with fopen()
+ *
+ * decompression is done by a separate thread into a ring of buffers, from
+ * which the FILE* is read; xz files are decoded by several threads if they
+ * consist of multiple blocks (as created by xz -T); gzip and zstd streams
+ * can only be decoded sequentially, this is done in the one thread
+ *
+ * requires linking with -lz -llzma (and -lzstd if ZFILE_ZSTD is defined)
+ * and -pthread
+ *
+ * note: copies of this file are in the patestgen, patestrun and misc
+ * directories, these should be kept in sync
+ *
+ * Copyright 2020 Daniel Kondor <kondor.dani@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of the  nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * example usage:
+
+FILE* f = zfile_open(fn); // fn == 0 means stdin
+if(!f) { ... } // error opening file
+read_table2 rt(f);
+... // read the contents
+fclose(f); // stops the decompression thread as well
+
+ */
+
+#ifndef ZFILE_H
+#define ZFILE_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+#include <zlib.h>
+#include <lzma.h>
+#ifdef ZFILE_ZSTD
+#include <zstd.h>
+#endif
+
+/* size and number of buffers in the ring */
+#ifndef ZFILE_BUFSIZE
+#define ZFILE_BUFSIZE 4194304UL
+#endif
+#define ZFILE_NBUF 4
+/* size of the buffer for the compressed input */
+#define ZFILE_INSIZE 1048576UL
+
+enum zfile_format { ZFILE_PLAIN = 0, ZFILE_GZIP, ZFILE_XZ, ZFILE_ZSTD };
+
+struct zfile {
+	FILE* raw = 0; /* the compressed file */
+	std::string fn; /* file name for error messages */
+	int format = ZFILE_PLAIN;
+	unsigned char prefix[8]; /* bytes already read for detecting the format */
+	size_t prefix_len = 0;
+	size_t prefix_pos = 0;
+	std::vector<char> in; /* compressed input */
+	bool in_eof = false;
+
+	/* decoder state (only the one for the format is used) */
+	z_stream zs;
+	bool gz_member_end = false; /* last gzip member ended, no input after it yet */
+	lzma_stream ls = LZMA_STREAM_INIT;
+#ifdef ZFILE_ZSTD
+	ZSTD_DCtx* zd = 0;
+	ZSTD_inBuffer zin = {0, 0, 0};
+	size_t zret = 0; /* last return value of ZSTD_decompressStream(), 0 at the end of a frame */
+#endif
+
+	/* ring of decompressed buffers: [head, tail) are filled and can be read */
+	std::vector<char> bufs[ZFILE_NBUF];
+	size_t lens[ZFILE_NBUF];
+	uint64_t head = 0;
+	uint64_t tail = 0;
+	bool end = false; /* no more buffers will be added */
+	bool err = false; /* error while decompressing */
+	bool stop = false; /* set when the file is closed before reading everything */
+	std::mutex m;
+	std::condition_variable cv_data; /* signaled when a buffer is added */
+	std::condition_variable cv_free; /* signaled when a buffer is released */
+	std::thread th;
+
+	/* current buffer being read (only used by the reader) */
+	const char* cur = 0;
+	size_t cur_len = 0;
+	size_t pos = 0;
+};
+
+/* read the compressed input (after the bytes used for detecting the format) */
+static size_t zfile_in(zfile* z, char* buf, size_t len) {
+	size_t r = 0;
+	if(z->prefix_pos < z->prefix_len) {
+		r = std::min(len, z->prefix_len - z->prefix_pos);
+		memcpy(buf, z->prefix + z->prefix_pos, r);
+		z->prefix_pos += r;
+	}
+	if(r < len && !z->in_eof) {
+		size_t r2 = fread(buf + r, 1, len - r, z->raw);
+		if(r2 < len - r) z->in_eof = true;
+		r += r2;
+	}
+	return r;
+}
+
+/* decompress into out, until it is full or the input ends;
+ * returns 0 if more data follows, 1 at the end of the input, -1 on error */
+static int zfile_decode(zfile* z, char* out, size_t size, size_t* len) {
+	*len = 0;
+	switch(z->format) {
+		case ZFILE_PLAIN:
+			*len = zfile_in(z, out, size);
+			if(*len < size) return ferror(z->raw) ? -1 : 1;
+			return 0;
+		case ZFILE_GZIP:
+			z->zs.next_out = (Bytef*)out;
+			z->zs.avail_out = size;
+			while(z->zs.avail_out) {
+				if(!z->zs.avail_in) {
+					size_t r = zfile_in(z, z->in.data(), ZFILE_INSIZE);
+					if(!r) {
+						*len = size - z->zs.avail_out;
+						if(ferror(z->raw) || !z->gz_member_end) return -1; /* truncated file */
+						return 1;
+					}
+					z->zs.next_in = (Bytef*)z->in.data();
+					z->zs.avail_in = r;
+				}
+				z->gz_member_end = false;
+				int ret = inflate(&z->zs, Z_NO_FLUSH);
+				if(ret == Z_STREAM_END) {
+					/* there can be more members concatenated (e.g. from pigz or cat) */
+					z->gz_member_end = true;
+					if(inflateReset(&z->zs) != Z_OK) return -1;
+				}
+				else if(ret != Z_OK && ret != Z_BUF_ERROR) return -1;
+			}
+			*len = size;
+			return 0;
+		case ZFILE_XZ:
+			z->ls.next_out = (uint8_t*)out;
+			z->ls.avail_out = size;
+			while(z->ls.avail_out) {
+				if(!z->ls.avail_in && !z->in_eof) {
+					z->ls.next_in = (const uint8_t*)z->in.data();
+					z->ls.avail_in = zfile_in(z, z->in.data(), ZFILE_INSIZE);
+					if(ferror(z->raw)) return -1;
+				}
+				lzma_ret ret = lzma_code(&z->ls, z->in_eof ? LZMA_FINISH : LZMA_RUN);
+				if(ret == LZMA_STREAM_END) {
+					*len = size - z->ls.avail_out;
+					return 1;
+				}
+				if(ret != LZMA_OK) return -1;
+			}
+			*len = size;
+			return 0;
+#ifdef ZFILE_ZSTD
+		case ZFILE_ZSTD:
+			{
+				ZSTD_outBuffer zout = {out, size, 0};
+				while(zout.pos < zout.size) {
+					if(z->zin.pos == z->zin.size) {
+						size_t r = zfile_in(z, z->in.data(), ZFILE_INSIZE);
+						if(!r) {
+							*len = zout.pos;
+							if(ferror(z->raw) || z->zret) return -1; /* truncated file */
+							return 1;
+						}
+						z->zin.src = z->in.data();
+						z->zin.size = r;
+						z->zin.pos = 0;
+					}
+					z->zret = ZSTD_decompressStream(z->zd, &zout, &z->zin);
+					if(ZSTD_isError(z->zret)) return -1;
+				}
+				*len = size;
+				return 0;
+			}
+#endif
+		default:
+			return -1;
+	}
+}
+
+/* decompression thread: fill the buffers in the ring */
+static void zfile_thread(zfile* z) {
+	while(true) {
+		{
+			std::unique_lock<std::mutex> lock(z->m);
+			z->cv_free.wait(lock, [z]() { return z->tail - z->head < ZFILE_NBUF || z->stop; });
+			if(z->stop) return;
+		}
+		size_t i = z->tail % ZFILE_NBUF;
+		size_t len;
+		int ret = zfile_decode(z, z->bufs[i].data(), ZFILE_BUFSIZE, &len);
+		if(ret < 0) fprintf(stderr,"zfile: error decompressing file %s!\n", z->fn.c_str());
+		std::unique_lock<std::mutex> lock(z->m);
+		z->lens[i] = len;
+		if(len) z->tail++;
+		if(ret) {
+			z->end = true;
+			z->err = (ret < 0);
+		}
+		z->cv_data.notify_one();
+		if(ret) return;
+	}
+}
+
+static ssize_t zfile_read(void* cookie, char* buf, size_t size) {
+	zfile* z = (zfile*)cookie;
+	size_t done = 0;
+	while(done < size) {
+		if(z->pos == z->cur_len) {
+			std::unique_lock<std::mutex> lock(z->m);
+			if(z->cur) {
+				/* release the current buffer */
+				z->head++;
+				z->cur = 0;
+				z->cur_len = 0;
+				z->pos = 0;
+				z->cv_free.notify_one();
+			}
+			if(done && z->head == z->tail) break; /* do not wait if there is already some data */
+			z->cv_data.wait(lock, [z]() { return z->head < z->tail || z->end; });
+			if(z->head == z->tail) {
+				if(z->err && !done) return -1;
+				break;
+			}
+			size_t i = z->head % ZFILE_NBUF;
+			z->cur = z->bufs[i].data();
+			z->cur_len = z->lens[i];
+		}
+		size_t n = std::min(size - done, z->cur_len - z->pos);
+		memcpy(buf + done, z->cur + z->pos, n);
+		z->pos += n;
+		done += n;
+	}
+	return done;
+}
+
+static void zfile_free(zfile* z) {
+	switch(z->format) {
+		case ZFILE_GZIP:
+			inflateEnd(&z->zs);
+			break;
+		case ZFILE_XZ:
+			lzma_end(&z->ls);
+			break;
+#ifdef ZFILE_ZSTD
+		case ZFILE_ZSTD:
+			if(z->zd) ZSTD_freeDCtx(z->zd);
+			break;
+#endif
+	}
+	if(z->raw) fclose(z->raw);
+	delete z;
+}
+
+static int zfile_close(void* cookie) {
+	zfile* z = (zfile*)cookie;
+	{
+		std::unique_lock<std::mutex> lock(z->m);
+		z->stop = true;
+		z->cv_free.notify_one();
+	}
+	if(z->th.joinable()) z->th.join();
+	zfile_free(z);
+	return 0;
+}
+
+/* open the given file (or stdin if fn == 0) for reading, decompressing it
+ * if needed; nthreads is the maximum number of threads used for decoding
+ * xz files (0: use all CPUs); returns 0 on error; the result should be
+ * closed with fclose() */
+static FILE* zfile_open(const char* fn, unsigned int nthreads = 0) {
+	FILE* raw = fn ? fopen(fn, "r") : stdin;
+	if(!raw) return 0;
+	zfile* z = new zfile;
+	z->raw = raw;
+	z->fn = fn ? fn : "<stdin>";
+	while(z->prefix_len < 6) {
+		size_t r = fread(z->prefix + z->prefix_len, 1, 6 - z->prefix_len, raw);
+		if(!r) break;
+		z->prefix_len += r;
+	}
+	if(ferror(raw)) { zfile_free(z); return 0; }
+	if(!z->prefix_len) z->in_eof = true;
+
+	const unsigned char* p = z->prefix;
+	size_t n = z->prefix_len;
+	if(n >= 2 && p[0] == 0x1f && p[1] == 0x8b) z->format = ZFILE_GZIP;
+	else if(n >= 6 && !memcmp(p, "\xfd" "7zXZ\x00", 6)) z->format = ZFILE_XZ;
+	else if(n >= 4 && p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f && p[3] == 0xfd) z->format = ZFILE_ZSTD;
+
+	if(z->format == ZFILE_PLAIN && fseek(raw, 0, SEEK_SET) == 0) {
+		/* regular uncompressed file, can be used directly */
+		z->raw = 0;
+		delete z;
+		return raw;
+	}
+
+	if(!nthreads) nthreads = std::thread::hardware_concurrency();
+	if(!nthreads) nthreads = 1;
+	bool ok = true;
+	switch(z->format) {
+		case ZFILE_GZIP:
+			memset(&z->zs, 0, sizeof(z_stream));
+			ok = (inflateInit2(&z->zs, 15 + 16) == Z_OK);
+			break;
+		case ZFILE_XZ:
+			{
+				lzma_mt mt;
+				memset(&mt, 0, sizeof(lzma_mt));
+				mt.flags = LZMA_CONCATENATED;
+				mt.threads = nthreads;
+				mt.memlimit_threading = lzma_physmem() / 4;
+				mt.memlimit_stop = UINT64_MAX;
+				ok = (lzma_stream_decoder_mt(&z->ls, &mt) == LZMA_OK);
+			}
+			break;
+		case ZFILE_ZSTD:
+#ifdef ZFILE_ZSTD
+			z->zd = ZSTD_createDCtx();
+			ok = (z->zd != 0);
+#else
+			fprintf(stderr,"zfile_open(): %s is compressed with zstd, which is not supported (compile with -DZFILE_ZSTD)!\n", z->fn.c_str());
+			ok = false;
+#endif
+			break;
+	}
+	if(!ok) {
+		zfile_free(z);
+		return 0;
+	}
+	if(z->format != ZFILE_PLAIN) z->in.resize(ZFILE_INSIZE);
+	for(size_t i = 0; i < ZFILE_NBUF; i++) z->bufs[i].resize(ZFILE_BUFSIZE);
+
+	cookie_io_functions_t io = {zfile_read, 0, 0, zfile_close};
+	FILE* f = fopencookie(z, "r", io);
+	if(!f) {
+		zfile_free(z);
+		return 0;
+	}
+	z->th = std::thread(zfile_thread, z);
+	return f;
+}
+
+#endif
+
@@ -0,0 +1,113 @@
+/*
+ * checkpoint.cpp -- a futás állapotának mentése a háttérben
+ *
+ * Copyright 2020 Kondor Dániel <kondor.dani@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "checkpoint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+
+int ckpt_init(ckpt* c, const char* fn) {
+	c->pid = 0;
+	c->fn = strdup(fn);
+	c->tmp = (char*)malloc(strlen(fn) + 5);
+	if(!(c->fn && c->tmp)) {
+		free(c->fn);
+		free(c->tmp);
+		c->fn = 0;
+		c->tmp = 0;
+		return 1;
+	}
+	sprintf(c->tmp,"%s.tmp",fn);
+	return 0;
+}
+
+/* write all segments to the temporary file, then rename it
+ * (run in the child process, only uses system calls) */
+static int ckpt_child(const ckpt* c, const ckpt_seg* segs, size_t nsegs) {
+	int fd = open(c->tmp,O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,0644);
+	if(fd < 0) return 1;
+	for(size_t i=0;i<nsegs;i++) {
+		const char* p = (const char*)segs[i].p;
+		uint64_t len = segs[i].len;
+		while(len) {
+			size_t n = len > 1073741824UL ? 1073741824UL : len; //egyszerre legfeljebb 1 GiB
+			ssize_t r = write(fd,p,n);
+			if(r < 0) {
+				if(errno == EINTR) continue;
+				close(fd);
+				return 1;
+			}
+			p += r;
+			len -= r;
+		}
+	}
+	if(fdatasync(fd)) { close(fd); return 1; }
+	if(close(fd)) return 1;
+	if(rename(c->tmp,c->fn)) return 1;
+	return 0;
+}
+
+int ckpt_write(ckpt* c, const ckpt_seg* segs, size_t nsegs) {
+	if(c->pid) return 1;
+	pid_t pid = fork();
+	if(pid < 0) {
+		fprintf(stderr,"ckpt_write(): nem sikerült új folyamatot indítani!\n");
+		return 1;
+	}
+	if(pid == 0) {
+		int r = ckpt_child(c,segs,nsegs);
+		if(r) unlink(c->tmp);
+		_exit(r);
+	}
+	c->pid = pid;
+	return 0;
+}
+
+int ckpt_wait(ckpt* c, int block) {
+	if(!c->pid) return 0;
+	int status = 0;
+	pid_t r;
+	do r = waitpid(c->pid,&status,block ? 0 : WNOHANG);
+	while(r < 0 && errno == EINTR);
+	if(r == 0) return -1;
+	c->pid = 0;
+	if(r < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+		fprintf(stderr,"ckpt_wait(): error writing the checkpoint file %s!\n",c->fn);
+		return 1;
+	}
+	return 0;
+}
+
+int ckpt_free(ckpt* c) {
+	int r = ckpt_wait(c,1);
+	free(c->fn);
+	free(c->tmp);
+	c->fn = 0;
+	c->tmp = 0;
+	return r;
+}
+
@@ -0,0 +1,71 @@
+/*
+ * checkpoint.h -- a futás állapotának mentése a háttérben
+ *
+ * the state of a long computation (a list of memory areas) is saved to a
+ * file without stopping the computation: the process is forked, so the
+ * child has a copy-on-write snapshot of the memory at the time of the
+ * fork, and it writes it out while the parent continues; the parent only
+ * pays for the fork() itself and for the pages copied when it modifies
+ * them while the child is still writing
+ *
+ * the data is written to a temporary file first, which is renamed at the
+ * end, so the previous checkpoint is kept if the program is interrupted
+ * while writing
+ *
+ * note: the child process only uses system calls (no stdio or memory
+ * allocation), since other threads of the parent may hold locks at the
+ * time of the fork
+ *
+ * Copyright 2020 Kondor Dániel <kondor.dani@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+#include <stdint.h>
+#include <sys/types.h>
+
+//egy kiírandó memóriaterület
+typedef struct ckpt_seg_t {
+	const void* p;
+	uint64_t len;
+} ckpt_seg;
+
+typedef struct ckpt_t {
+	char* fn; //a checkpoint fájl neve
+	char* tmp; //ideiglenes fájl (fn + ".tmp")
+	pid_t pid; //az éppen író gyerek folyamat, vagy 0
+} ckpt;
+
+//inicializálás, eredmény: 0, ha rendben volt
+int ckpt_init(ckpt* c, const char* fn);
+
+//a segs-ben megadott területek kiírása egy új folyamatban (a korábbi írásnak be kell
+//	fejeződnie, lásd ckpt_wait()); eredmény: 0, ha a folyamatot sikerült elindítani
+int ckpt_write(ckpt* c, const ckpt_seg* segs, size_t nsegs);
+
+//várakozás az előző írás befejezésére (ha block == 0, csak ellenőrzés)
+//eredmény: 0, ha nincs folyamatban írás, vagy sikeresen befejeződött, -1, ha még
+//	folyamatban van (csak ha block == 0), 1, ha nem sikerült a kiírás
+int ckpt_wait(ckpt* c, int block);
+
+//lezárás (megvárja a folyamatban levő írást), eredmény: mint ckpt_wait()-nél
+int ckpt_free(ckpt* c);
+
+#endif
+
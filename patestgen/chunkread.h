@@ -0,0 +1,153 @@
+/*  -*- C++ -*-
+ * chunkread.h -- read a text file in large chunks, split at line
+ * 	boundaries, and parse the chunks in parallel; the results are merged
+ * 	in the original order of the chunks, so the end result is the same
+ * 	as reading the file line by line
+ *
+ * the file is read by the calling thread (if it is compressed and opened
+ * with zfile_open(), the decompression runs in a separate thread already,
+ * see zfile.h); each chunk is parsed
+ * by a new thread, with at most nthreads chunks being processed at the
+ * same time; results are passed to the merge function in the calling
+ * thread as soon as all previous chunks are merged
+ *
+ * Copyright 2020 Daniel Kondor <kondor.dani@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef CHUNKREAD_H
+#define CHUNKREAD_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <memory>
+#include <algorithm>
+
+#include "read_table.h"
+
+/* default size of one chunk */
+#ifndef CHUNKREAD_SIZE
+#define CHUNKREAD_SIZE 16777216UL
+#endif
+
+/* one chunk of the input and the result of parsing it */
+template<class Result>
+struct chunkread_job {
+	std::vector<char> buf;
+	size_t len = 0; /* length of the data in buf (buf may be longer) */
+	uint64_t line0 = 0; /* number of lines in the file before this chunk */
+	Result res;
+	int ret = 0; /* return value of the parse function */
+	std::thread th;
+};
+
+/* create a read_table that reads the lines of the given chunk
+ * (line numbers in error messages refer to the whole file); the FILE*
+ * returned in f should be closed by the caller after use */
+static inline int chunkread_table(const char* buf, size_t len, uint64_t line0, read_table* rt, FILE** f) {
+	*f = fmemopen((void*)buf, len, "r");
+	if(!*f) return 1;
+	read_table_init(rt, *f);
+	rt->line = line0;
+	return 0;
+}
+
+/* process the file f:
+ * 	parse(const char* buf, size_t len, uint64_t line0, Result& res) is
+ * 		called for each chunk (from a separate thread, if nthreads > 1),
+ * 		buf contains complete lines, line0 is the number of lines before it;
+ * 		it should return 0 on success
+ * 	merge(Result& res) is called for the results of each chunk in order
+ * 		(from the calling thread); it should return 0 on success
+ * nthreads == 0 means use all available CPUs
+ * returns 0 on success, -1 on read error, or the first nonzero value
+ * returned by parse or merge (in this case, later chunks are not merged) */
+template<class Result, class Parse, class Merge>
+static int chunkread(FILE* f, const Parse& parse, const Merge& merge,
+		unsigned int nthreads = 0, size_t chunk_size = CHUNKREAD_SIZE) {
+	if(!nthreads) nthreads = std::thread::hardware_concurrency();
+	if(!nthreads) nthreads = 1;
+
+	typedef chunkread_job<Result> job;
+	std::deque<std::unique_ptr<job> > jobs; /* chunks being processed */
+	std::vector<char> rest; /* partial line at the end of the previous chunk */
+	uint64_t lines = 0;
+	int ret = 0;
+	bool eof = false;
+
+	/* wait for the first chunk in the queue and merge its results */
+	auto finish_first = [&jobs,&merge,&ret]() {
+		std::unique_ptr<job> j = std::move(jobs.front());
+		jobs.pop_front();
+		if(j->th.joinable()) j->th.join();
+		if(!ret) ret = j->ret;
+		if(!ret) ret = merge(j->res);
+	};
+
+	while(!eof && !ret) {
+		std::unique_ptr<job> j(new job);
+		j->buf.swap(rest);
+		size_t len = j->buf.size();
+		size_t search = 0; /* position from where to search for a newline */
+		char* nl = 0;
+		/* read until at least one full line is found */
+		do {
+			j->buf.resize(len + chunk_size);
+			size_t r = fread(j->buf.data() + len, 1, chunk_size, f);
+			len += r;
+			if(r < chunk_size) {
+				if(ferror(f)) { ret = -1; break; }
+				eof = true;
+			}
+			if(len > search) nl = (char*)memrchr(j->buf.data() + search, '\n', len - search);
+			search = len;
+		} while(!(nl || eof));
+		if(ret) break;
+
+		if(eof) j->len = len;
+		else {
+			j->len = (nl - j->buf.data()) + 1;
+			rest.assign(j->buf.data() + j->len, j->buf.data() + len);
+		}
+		if(!j->len) break;
+		j->line0 = lines;
+		lines += std::count(j->buf.data(), j->buf.data() + j->len, '\n');
+
+		if(nthreads == 1) {
+			j->ret = parse(j->buf.data(), j->len, j->line0, j->res);
+			jobs.push_back(std::move(j));
+			finish_first();
+		}
+		else {
+			job* j1 = j.get();
+			j->th = std::thread([j1,&parse]() { j1->ret = parse(j1->buf.data(), j1->len, j1->line0, j1->res); });
+			jobs.push_back(std::move(j));
+			if(jobs.size() >= nthreads) finish_first();
+		}
+	}
+	while(jobs.size()) finish_first();
+	return ret;
+}
+
+#endif
+
@@ -0,0 +1,106 @@
+/*
+ * edgeef.cpp -- élek tömörített tárolása Elias-Fano kódolással
+ *
+ * Copyright 2020 Kondor Dániel <kondor.dani@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "edgeef.h"
+#include "memplace.h"
+
+
+//alsó bitek száma: log2(N*N / n) (lefelé kerekítve)
+static unsigned int edgeef_lbits(uint64_t n, uint64_t N) {
+	uint64_t q = (N*N) / n;
+	return q ? (63 - __builtin_clzll(q)) : 0;
+}
+
+//a tömbök mérete (64 bites szavakban)
+static void edgeef_sizes(uint64_t n, uint64_t N, unsigned int L, uint64_t* nb, uint64_t sizes[4]) {
+	*nb = ((N*N - 1) >> L) + 1;
+	sizes[0] = (n + *nb)/64 + 2; //upper (+1 szó, hogy a keresés túlolvashasson)
+	sizes[1] = (n*L)/64 + 2; //lower
+	sizes[2] = n/EDGEEF_SAMPLE + 1; //s1
+	sizes[3] = *nb/EDGEEF_SAMPLE + 1; //s0
+}
+
+uint64_t edgeef_size(uint64_t n, uint64_t N) {
+	if(!n || !N || N > UINT32_MAX) return 0;
+	uint64_t nb;
+	uint64_t sizes[4];
+	edgeef_sizes(n, N, edgeef_lbits(n, N), &nb, sizes);
+	return (sizes[0] + sizes[1] + sizes[2] + sizes[3])*sizeof(uint64_t);
+}
+
+int edgeef_init(edgeef* ef, uint64_t n, uint64_t N) {
+	ef->upper = ef->lower = ef->s1 = ef->s0 = nullptr;
+	ef->n = n;
+	ef->N = N;
+	ef->last = 0;
+	if(!n || !N || N > UINT32_MAX) return 1; //a kulcsok nem férnének el 64 biten
+	ef->L = edgeef_lbits(n, N);
+	uint64_t sizes[4];
+	edgeef_sizes(n, N, ef->L, &ef->nb, sizes);
+	ef->upper = (uint64_t*)memplace_alloc(sizes[0]*sizeof(uint64_t));
+	ef->lower = (uint64_t*)memplace_alloc(sizes[1]*sizeof(uint64_t));
+	ef->s1 = (uint64_t*)memplace_alloc(sizes[2]*sizeof(uint64_t));
+	ef->s0 = (uint64_t*)memplace_alloc(sizes[3]*sizeof(uint64_t));
+	if(!(ef->upper && ef->lower && ef->s1 && ef->s0)) {
+		edgeef_free(ef);
+		return 1;
+	}
+	return 0;
+}
+
+//az [h0,h1) bucket-ek lezárása (j az utánuk következő első elem)
+static void edgeef_close(edgeef* ef, uint64_t h0, uint64_t h1, uint64_t j) {
+	uint64_t k = ((h0 + EDGEEF_SAMPLE - 1) / EDGEEF_SAMPLE) * EDGEEF_SAMPLE;
+	for(; k < h1; k += EDGEEF_SAMPLE) ef->s0[k / EDGEEF_SAMPLE] = k + j;
+}
+
+int edgeef_add(edgeef* ef, uint64_t j, nodeid i1, nodeid i2) {
+	if(j >= ef->n || i1 >= ef->N || i2 >= ef->N) return 1;
+	uint64_t x = (uint64_t)i1 * ef->N + i2;
+	if(j && x <= ef->last) return 1;
+	uint64_t h = x >> ef->L;
+	edgeef_close(ef, j ? (ef->last >> ef->L) : 0, h, j);
+	uint64_t pos = h + j;
+	ef->upper[pos >> 6] |= 1UL << (pos & 63);
+	if(j % EDGEEF_SAMPLE == 0) ef->s1[j / EDGEEF_SAMPLE] = pos;
+	if(ef->L) {
+		uint64_t low = x & ((1UL << ef->L) - 1);
+		pos = j*ef->L;
+		unsigned int sh = pos & 63;
+		ef->lower[pos >> 6] |= low << sh;
+		if(sh + ef->L > 64) ef->lower[(pos >> 6) + 1] |= low >> (64 - sh);
+	}
+	ef->last = x;
+	return 0;
+}
+
+void edgeef_finish(edgeef* ef) {
+	edgeef_close(ef, ef->last >> ef->L, ef->nb, ef->n);
+}
+
+void edgeef_free(edgeef* ef) {
+	if(ef->upper) memplace_free(ef->upper);
+	if(ef->lower) memplace_free(ef->lower);
+	if(ef->s1) memplace_free(ef->s1);
+	if(ef->s0) memplace_free(ef->s0);
+	ef->upper = ef->lower = ef->s1 = ef->s0 = nullptr;
+}
+
@@ -0,0 +1,168 @@
+/*
+ * edgeef.h -- élek tömörített tárolása Elias-Fano kódolással
+ *
+ * the edges sorted by (p1,p2) are stored as the increasing sequence of keys
+ * x = i1 * N + i2, where i1 and i2 are the indices of the nodes in the idlist
+ * and N is the number of nodes; each key is split into its lower L bits
+ * (stored in a packed array) and its upper bits (stored in unary: element j
+ * is a 1 bit at position (x >> L) + j, every "bucket" of elements with the
+ * same upper bits is closed by a 0 bit); with L = log2(N*N / n), this needs
+ * about L + 2 bits per edge, instead of 2 * sizeof(nodeid) bytes
+ *
+ * the position of every EDGEEF_SAMPLE-th 1 and 0 bit is saved, so that the
+ * position of any of them can be found by scanning a few words (select);
+ * this gives:
+ * 	edgeef_find(): the index of the edge i1 -> i2 (i.e. its rank among the
+ * 		edges, the same as its index in the sorted array of edges), this
+ * 		looks up the bucket of the key, then searches its lower bits
+ * 		(binary search for the buckets of hubs)
+ * 	edgeef_get(): the nodes of the edge with the given index
+ * the structure is read-only after creation and can be used from several
+ * threads; the mutable state of the edges is stored separately (see edgestate
+ * in edges.h); node indices have to be less than 2^32 (so that the keys fit
+ * in 64 bits)
+ *
+ * Copyright 2020 Kondor Dániel <kondor.dani@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+
+#ifndef EDGEEF_H
+#define EDGEEF_H
+#include "idlist.h"
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+#define EDGEEF_SAMPLE 256 //minden ennyiedik 1 és 0 bit helyét tároljuk
+#define EDGEEF_SCAN 16 //ennél kisebb bucket-ekben lineáris keresés
+
+typedef struct edgeef_t {
+	uint64_t* upper; //felső bitek unárisan (az j. elem: 1 bit a (x_j >> L) + j helyen)
+	uint64_t* lower; //alsó L bit elemenként, folytonosan
+	uint64_t* s1; //minden EDGEEF_SAMPLE. 1 bit helye
+	uint64_t* s0; //minden EDGEEF_SAMPLE. 0 bit helye
+	uint64_t n; //elemek (élek) száma
+	uint64_t N; //pontok száma
+	uint64_t nb; //bucket-ek (0 bitek) száma
+	uint64_t last; //az utolsó hozzáadott kulcs (csak létrehozás közben)
+	unsigned int L; //alsó bitek száma
+} edgeef;
+
+//a j. elem alsó bitjei
+static inline uint64_t edgeef_low(const edgeef* ef, uint64_t j) {
+	if(!ef->L) return 0;
+	uint64_t pos = j*ef->L;
+	unsigned int sh = pos & 63;
+	uint64_t x = ef->lower[pos >> 6] >> sh;
+	if(sh + ef->L > 64) x |= ef->lower[(pos >> 6) + 1] << (64 - sh);
+	return x & ((1UL << ef->L) - 1);
+}
+
+//az r. (0-tól számolva) 1 bit helye egy 64 bites szóban
+static inline unsigned int edgeef_select64(uint64_t w, unsigned int r) {
+#ifdef __BMI2__
+	return __builtin_ctzll(_pdep_u64(1UL << r, w));
+#else
+	for(; r; r--) w &= w - 1;
+	return __builtin_ctzll(w);
+#endif
+}
+
+//a k. (0-tól számolva) 1 bit (bit1 == 1) vagy 0 bit (bit1 == 0) helye a felső bitekben
+static inline uint64_t edgeef_select(const edgeef* ef, uint64_t k, int bit1) {
+	uint64_t pos = bit1 ? ef->s1[k / EDGEEF_SAMPLE] : ef->s0[k / EDGEEF_SAMPLE];
+	uint64_t r = k % EDGEEF_SAMPLE;
+	uint64_t i = pos >> 6;
+	uint64_t w = bit1 ? ef->upper[i] : ~ef->upper[i];
+	w &= (~0UL) << (pos & 63);
+	while(1) {
+		uint64_t c = __builtin_popcountll(w);
+		if(r < c) return 64*i + edgeef_select64(w, (unsigned int)r);
+		r -= c;
+		i++;
+		w = bit1 ? ef->upper[i] : ~ef->upper[i];
+	}
+}
+
+//az i1 -> i2 él sorszáma, vagy ef->n, ha nincs ilyen él
+static inline uint64_t edgeef_find(const edgeef* ef, nodeid i1, nodeid i2) {
+	if(i1 >= ef->N || i2 >= ef->N) return ef->n;
+	uint64_t x = (uint64_t)i1 * ef->N + i2;
+	uint64_t h = x >> ef->L;
+	if(h >= ef->nb) return ef->n;
+	//a bucket első eleme: a h. 0 bit után (az előtte levő 1 bitek száma)
+	uint64_t p = h ? (edgeef_select(ef, h - 1, 0) + 1) : 0;
+	uint64_t start = p - h;
+	//a bucket vége: a következő 0 bit; rövid bucket esetén ugyanabban a szóban van
+	uint64_t w = ~ef->upper[p >> 6] >> (p & 63);
+	uint64_t end;
+	if(w) end = start + __builtin_ctzll(w);
+	else end = edgeef_select(ef, h, 0) - h;
+	uint64_t low = x & ((1UL << ef->L) - 1);
+	if(end - start > EDGEEF_SCAN) {
+		//sok él ugyanabban a bucket-ben ("hub"): bináris keresés
+		uint64_t end0 = end;
+		while(start < end) {
+			uint64_t mid = start + (end - start)/2;
+			if(edgeef_low(ef, mid) < low) start = mid + 1;
+			else end = mid;
+		}
+		if(start < end0 && edgeef_low(ef, start) == low) return start;
+		return ef->n;
+	}
+	for(; start < end; start++) {
+		uint64_t y = edgeef_low(ef, start);
+		if(y == low) return start;
+		if(y > low) break;
+	}
+	return ef->n;
+}
+
+//az edgeef_find() által először olvasott memória előzetes betöltése (lásd edges_find_prefetch())
+static inline void edgeef_prefetch(const edgeef* ef, nodeid i1, nodeid i2, int step) {
+	if(i1 >= ef->N || i2 >= ef->N) return;
+	uint64_t h = ((uint64_t)i1 * ef->N + i2) >> ef->L;
+	if(h == 0 || h >= ef->nb) return;
+	if(step == 0) __builtin_prefetch(ef->s0 + (h - 1) / EDGEEF_SAMPLE);
+	else __builtin_prefetch(ef->upper + (ef->s0[(h - 1) / EDGEEF_SAMPLE] >> 6));
+}
+
+//a j. él végpontjai (sorszámok az idlist-ben)
+static inline void edgeef_get(const edgeef* ef, uint64_t j, nodeid* i1, nodeid* i2) {
+	uint64_t h = edgeef_select(ef, j, 1) - j;
+	uint64_t x = (h << ef->L) | edgeef_low(ef, j);
+	uint64_t y = x / ef->N;
+	if(i1) *i1 = (nodeid)y;
+	if(i2) *i2 = (nodeid)(x - y*ef->N);
+}
+
+//várható méret bájtban n él és N pont esetén
+uint64_t edgeef_size(uint64_t n, uint64_t N);
+
+//létrehozás n él és N pont számára; ezután az éleket sorban kell hozzáadni edgeef_add()-dal,
+//	végül edgeef_finish() -- eredmény: 0, ha rendben volt
+int edgeef_init(edgeef* ef, uint64_t n, uint64_t N);
+//a j. él hozzáadása (a kulcsoknak szigorúan növekvőnek kell lenni) -- eredmény: 0, ha rendben volt
+int edgeef_add(edgeef* ef, uint64_t j, nodeid i1, nodeid i2);
+//a mintavételezett helyek befejezése az összes él hozzáadása után
+void edgeef_finish(edgeef* ef);
+//memória felszabadítása
+void edgeef_free(edgeef* ef);
+
+#endif
+
@@ -24,7 +24,7 @@
 
 void edgeheap::clean() {
 	if(heap != MAP_FAILED) {
-		munmap(heap,hsize*sizeof(uint64_t));
+		memplace_munmap(heap,hsize*sizeof(uint64_t));
 		heap = (uint64_t*)MAP_FAILED;
 	}
 	hsize = 0;
@@ -33,7 +33,8 @@ void edgeheap::clean() {
 
 int edgeheap::grow() {
 	uint64_t grow1 = grow0;
-	if(hsize > heap_max_size - grow1) grow1 = heap_max_size - hsize;
+	uint64_t max_size = heap_max_size();
+	if(hsize > max_size - grow1) grow1 = max_size - hsize;
 	if(!grow1) {
 		fprintf(stderr,"edgeheap::grow(): heap mérete már elérte a maximumot!\n");
 		return 4;
@@ -45,7 +46,7 @@ int edgeheap::grow() {
 			fprintf(stderr,"edgeheap::grow(): hibás adatok!\n");
 			return 1; //hiba
 		}
-		void* ptr2 = (void*)mremap(heap,old_size,old_size+map_size,MREMAP_MAYMOVE);
+		void* ptr2 = memplace_mremap(heap,old_size,old_size+map_size);
 		if(ptr2 == MAP_FAILED) {
 			fprintf(stderr,"edgeheap::grow(): nincs elég memória!\n");
 			return 2;
@@ -54,7 +55,7 @@ int edgeheap::grow() {
 		hsize += grow1;
 	}
 	else {
-		void* ptr2 = mmap(0,map_size,PROT_READ | PROT_WRITE,MAP_ANONYMOUS | MAP_PRIVATE,-1,0);
+		void* ptr2 = memplace_mmap(map_size);
 		if(ptr2 == MAP_FAILED) {
 			fprintf(stderr,"edges_grow(): nincs elég memória!\n");
 			return 3;
@@ -66,16 +67,15 @@ int edgeheap::grow() {
 }
 
 void edgeheap::heapup(uint64_t i) { // szokásos heapup, elem felvitele amíg lehet
-	edge* e1 = e->e;
-	unsigned int timestamp = e1[heap[i]].timestamp;
+	unsigned int timestamp = ts(heap[i]);
 	while(i) {
 		uint64_t parent = (i-1)/2;
-		if(timestamp < e1[heap[parent]].timestamp) {
+		if(timestamp < ts(heap[parent])) {
 			uint64_t tmp = heap[i];
 			heap[i] = heap[parent];
 			heap[parent] = tmp;
-			e1[heap[i]].offset = i;
-			e1[heap[parent]].offset = parent;
+			set_off(heap[i],i);
+			set_off(heap[parent],parent);
 			i = parent;
 		}
 		else break;
@@ -83,22 +83,21 @@ void edgeheap::heapup(uint64_t i) { // szokásos heapup, elem felvitele amíg le
 }
 
 void edgeheap::heapdown(uint64_t i) { // szokásos heapdown, elem elhelyezése a helyére
-	edge* e1 = e->e;
-	unsigned int timestamp = e1[heap[i]].timestamp;
+	unsigned int timestamp = ts(heap[i]);
 	while(1) {
 		uint64_t c1 = 2*i+1;
 		uint64_t c2 = 2*i+2;
 		if(c1 >= hn) break; //már az alján vagyunk
 		//~ unsigned int c;
-		if(e1[heap[c1]].timestamp < timestamp) {
+		if(ts(heap[c1]) < timestamp) {
 			if(c2 < hn) {
-				if(e1[heap[c2]].timestamp < e1[heap[c1]].timestamp) {
+				if(ts(heap[c2]) < ts(heap[c1])) {
 					//c2 helyére kell betenni
 					uint64_t tmp = heap[i];
 					heap[i] = heap[c2];
 					heap[c2] = tmp;
-					e1[heap[i]].offset = i;
-					e1[heap[c2]].offset = c2;
+					set_off(heap[i],i);
+					set_off(heap[c2],c2);
 					i = c2;
 					continue;
 				}
@@ -107,20 +106,20 @@ void edgeheap::heapdown(uint64_t i) { // szokásos heapdown, elem elhelyezése a
 			uint64_t tmp = heap[i];
 			heap[i] = heap[c1];
 			heap[c1] = tmp;
-			e1[heap[i]].offset = i;
-			e1[heap[c1]].offset = c1;
+			set_off(heap[i],i);
+			set_off(heap[c1],c1);
 			i = c1;
 			continue;
 		}
 		else {
 			if(c2 < hn) {
-				if(e1[heap[c2]].timestamp < timestamp) {
+				if(ts(heap[c2]) < timestamp) {
 					//c2 helyére kell betenni
 					uint64_t tmp = heap[i];
 					heap[i] = heap[c2];
 					heap[c2] = tmp;
-					e1[heap[i]].offset = i;
-					e1[heap[c2]].offset = c2;
+					set_off(heap[i],i);
+					set_off(heap[c2],c2);
 					i = c2;
 					continue;
 				}
@@ -133,24 +132,22 @@ void edgeheap::heapdown(uint64_t i) { // szokásos heapdown, elem elhelyezése a
 void edgeheap::shiftup(uint64_t i) { // i-edik elem átrendezése legfelülre -- ez nem tartja meg a heap-tulajdonságot, de csak
 		// az 0. elem lesz hibás, a két al-heap jó marad
 		// ez után a 0. elemet törölni kell, és egy új elemet kell a helyére beilleszteni, majd levinni, ameddig lehet
-	edge* e1 = e->e;
 	uint64_t hi = heap[i]; //hi legfelülre, a többi rekurzívan lefele
 		//itt nem kell a timestamp-okat ellenőrizni, azok jók maradnak
 	while(i) {
 		uint64_t p = (i-1)/2;
 		heap[i] = heap[p];
-		e1[heap[i]].offset = i;
+		set_off(heap[i],i);
 		i = p;
 	}
 	heap[0] = hi;
-	e1[heap[0]].offset = 0;
+	set_off(heap[0],0);
 }
 
 int edgeheap::add(uint64_t n) { //edges[n] hozzáadása
-	edge* e1 = e->e;
 	if(hn >= hsize) {
-		/* offset is still 32-bits -- do not allow inserting more than 2^32-1 elements */
-		if(hn == heap_max_size) {
+		/* offsets are 32 or 40 bits (see edgeidx_width()) */
+		if(hn == heap_max_size()) {
 			fprintf(stderr,"edgeheap::add(%lu): heap mérete elérte a maximumot!\n",n);
 			return 1;
 		}
@@ -158,15 +155,14 @@ int edgeheap::add(uint64_t n) { //edges[n] hozzáadása
 		if(r) return r;
 	}
 	heap[hn] = n;
-	e1[n].offset = hn;
+	set_off(n,hn);
 	hn++;
 	heapup(hn-1);
 	return 0;
 }
 
 int edgeheap::del(uint64_t n) { //edges[n] törlése
-	edge* e1 = e->e;
-	uint64_t i = e1[n].offset;
+	uint64_t i = get_off(n);
 	if(i >= hn) {
 		fprintf(stderr,"edgeheap::del(%lu): a törölni kívánt elem nem szerepel a heap-ben!\n",n);
 		return 1;
@@ -180,7 +176,7 @@ int edgeheap::del(uint64_t n) { //edges[n] törlése
 	shiftup(i);
 	hn--;
 	heap[0] = heap[hn];
-	e1[heap[0]].offset = 0;
+	set_off(heap[0],0);
 	heapdown(0);
 	return 0;
 }
@@ -194,10 +190,9 @@ void edgeheap::del0() {
 		hn--;
 		return;
 	}
-	edge* e1 = e->e;
 	hn--;
 	heap[0] = heap[hn];
-	e1[heap[0]].offset = 0;
+	set_off(heap[0],0);
 	heapdown(0);
 }
 
@@ -32,17 +32,25 @@ class edgeheap {
 		uint64_t hsize; //heap mérete (elemek száma)
 		uint64_t hn; //aktív (felhasznált) elemek száma
 		uint64_t grow0; //növelés ennyivel egyszerre
-		edges* e; //éleket tároló struktúra
-		static constexpr uint64_t heap_max_size = UINT32_MAX;
+		edgestate s; //élek időpontjai és heap-beli helye (nem a heap foglalja le)
 		
-		edgeheap() { heap = (uint64_t*)MAP_FAILED; hsize = 0; hn = 0; grow0 = 131072; e = 0; }
-		edgeheap(uint64_t grow1) { heap = (uint64_t*)MAP_FAILED; hsize = 0; hn = 0; grow0 = grow1; e = 0; }
-		edgeheap(edges* e1) { heap = (uint64_t*)MAP_FAILED; hsize = 0; hn = 0; grow0 = 131072; e = e1; }
-		edgeheap(edges* e1, uint64_t grow1) { heap = (uint64_t*)MAP_FAILED; hsize = 0; hn = 0; grow0 = grow1; e = e1; }
+		edgeheap() { heap = (uint64_t*)MAP_FAILED; hsize = 0; hn = 0; grow0 = 131072; s = edgestate(); }
+		edgeheap(uint64_t grow1) { heap = (uint64_t*)MAP_FAILED; hsize = 0; hn = 0; grow0 = grow1; s = edgestate(); }
+		//ezekben az élek állapota itt van lefoglalva, edgestate_free(&s)-el kell felszabadítani
+		edgeheap(edges* e1) { heap = (uint64_t*)MAP_FAILED; hsize = 0; hn = 0; grow0 = 131072; edgestate_init(&s,e1,EDGESTATE_TS | EDGESTATE_OFF); }
+		edgeheap(edges* e1, uint64_t grow1) { heap = (uint64_t*)MAP_FAILED; hsize = 0; hn = 0; grow0 = grow1; edgestate_init(&s,e1,EDGESTATE_TS | EDGESTATE_OFF); }
+		edgeheap(const edgestate& s1) { heap = (uint64_t*)MAP_FAILED; hsize = 0; hn = 0; grow0 = 131072; s = s1; }
 		~edgeheap() {
 			clean();
 		}
 		
+		//n. él időpontja és heap-beli helye
+		unsigned int& ts(uint64_t n) const { return *edgestate_ts(&s,n); }
+		uint64_t get_off(uint64_t n) const { return edgestate_get_off(&s,n); }
+		void set_off(uint64_t n, uint64_t i) const { edgestate_set_off(&s,n,i); }
+		//legfeljebb ennyi elem lehet a heap-ben (off elemeinek méretétől függ)
+		uint64_t heap_max_size() const { return edgeidx_empty(s.off_width); }
+		
 		//memória felszabadítása
 		void clean();
 		//heap tömb növelése
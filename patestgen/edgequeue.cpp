@@ -0,0 +1,104 @@
+/*
+ * edgequeue.cpp -- élek lejárati sorrendje rögzített élettartam esetén
+ * 
+ * Copyright 2020 Kondor Dániel <kondor.dani@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+ 
+#include "edgequeue.h"
+
+
+void edgequeue::clean() {
+	if(q != MAP_FAILED) {
+		memplace_munmap(q,qsize*isize);
+		q = (unsigned char*)MAP_FAILED;
+	}
+	if(sq != MAP_FAILED) {
+		memplace_munmap(sq,qsize*sizeof(uint64_t));
+		sq = (uint64_t*)MAP_FAILED;
+	}
+	qsize = 0;
+	head = 0;
+	tail = 0;
+}
+
+int edgequeue::grow() {
+	uint64_t size1 = qsize ? 2*qsize : 131072;
+	if(!qsize) {
+		width = edgeidx_width(s.n);
+		isize = width + 4;
+	}
+	void* ptr2 = memplace_mmap(size1*isize);
+	if(ptr2 == MAP_FAILED) {
+		fprintf(stderr,"edgequeue::grow(): nincs elég memória!\n");
+		return 2;
+	}
+	unsigned char* q2 = (unsigned char*)ptr2;
+	uint64_t* sq2 = (uint64_t*)MAP_FAILED;
+	if(track_seq) {
+		sq2 = (uint64_t*)memplace_mmap(size1*sizeof(uint64_t));
+		if(sq2 == MAP_FAILED) {
+			memplace_munmap(q2,size1*isize);
+			fprintf(stderr,"edgequeue::grow(): nincs elég memória!\n");
+			return 2;
+		}
+	}
+	//elemek átmásolása sorrendben az új tömb elejére
+	uint64_t n = tail - head;
+	for(uint64_t i=0;i<n;i++) memcpy(q2 + isize*i, item(head + i), isize);
+	if(track_seq) for(uint64_t i=0;i<n;i++) sq2[i] = sq[(head + i) & (qsize-1)];
+	if(q != MAP_FAILED) memplace_munmap(q,qsize*isize);
+	if(sq != MAP_FAILED) memplace_munmap(sq,qsize*sizeof(uint64_t));
+	q = q2;
+	sq = sq2;
+	qsize = size1;
+	head = 0;
+	tail = n;
+	return 0;
+}
+
+uint64_t edgequeue::compact() {
+	uint64_t j = head;
+	for(uint64_t i=head;i<tail;i++) {
+		const unsigned char* x = item(i);
+		if(ts(item_e(x)) != item_ts(x)) continue; //később újra aktív volt, ugyanaz, mint pop()-ban
+		if(i != j) {
+			memcpy(item(j), x, isize);
+			if(track_seq) sq[j & (qsize-1)] = sq[i & (qsize-1)];
+		}
+		j++;
+	}
+	uint64_t r = tail - j;
+	tail = j;
+	return r;
+}
+
+int edgequeue::make_room() {
+	if(qsize) {
+		compact();
+		//legalább a fele szabad: elég a törölt elemek helye (így a tömörítés költsége elemenként O(1))
+		if(2*(tail - head) <= qsize) return 0;
+	}
+	return grow();
+}
+
+int edgequeue::add_error(uint64_t n) {
+	if(n >= s.n) fprintf(stderr,"edgequeue::add(%lu): hibás él sorszám (%lu él van)!\n",n,s.n);
+	else fprintf(stderr,"edgequeue::add(%lu): a tranzakciók nincsenek idő szerint rendezve (%u < %u)!\n",n,ts(n),last_ts);
+	return 5;
+}
+
@@ -0,0 +1,158 @@
+/*
+ * edgequeue.h -- élek lejárati sorrendje rögzített élettartam esetén
+ * 
+ * if all edges have the same lifetime and the transactions are processed
+ * in time order, edges expire in the same order as they were last active;
+ * so instead of a heap, a FIFO queue (ring buffer) is enough: each time an
+ * edge is active, it is appended to the end of the queue, expired edges are
+ * taken from the front; earlier entries of edges that were active again
+ * later are skipped (these are recognized by having a different timestamp
+ * than the one stored in the edge state); both operations are O(1) with
+ * sequential memory access (except for checking the state of the edge)
+ * 
+ * an edge that is active many times within its lifetime has several entries
+ * in the queue, only the last one of these is valid; so that the size of the
+ * queue does not grow with the number of transactions, when it is full, the
+ * entries that are not valid anymore are removed first (compact()), and the
+ * buffer is only doubled if at least half of it is still used after this;
+ * as each edge has at most one valid entry, the buffer is never larger than
+ * the smallest power of 2 that is at least twice the number of edges (or the
+ * initial size); the cost of compacting is amortized O(1) for each entry
+ * 
+ * each entry is the index of the edge (4 or 5 bytes, see edgeidx_width() in
+ * edges.h), followed by the time when it was added (4 bytes)
+ * 
+ * optionally, a sequence number (e.g. the index of the transaction) can be
+ * stored along with each entry (track_seq, used by the parallel version
+ * in patest_gen.c to merge the expiry order of several queues)
+ * 
+ * Copyright 2020 Kondor Dániel <kondor.dani@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+
+#ifndef EDGEQUEUE_H
+#define EDGEQUEUE_H
+#include "edges.h"
+
+class edgequeue {
+	public:
+		unsigned char* q; //ring buffer, elemenként isize bájt (él sorszáma, majd az időpontja)
+		unsigned int width; //az élek sorszámának mérete (4 vagy 5 bájt, s.n alapján)
+		unsigned int isize; //egy elem mérete (width + 4)
+		uint64_t qsize; //mérete (2 hatványa)
+		uint64_t head; //első elem (folyamatosan nő, a tömbbeli hely: head & (qsize-1))
+		uint64_t tail; //utolsó utáni elem
+		uint32_t last_ts; //legutoljára hozzáadott időpont
+		uint64_t* sq; //sorszámok (ugyanúgy, mint q-ban), csak ha track_seq != 0
+		int track_seq; //sorszámok tárolása (az első hozzáadás előtt kell beállítani)
+		edgestate s; //élek időpontjai (nem a sor foglalja le; csak a ts tömböt használjuk)
+		
+		edgequeue() { q = (unsigned char*)MAP_FAILED; sq = (uint64_t*)MAP_FAILED; width = 4; isize = 8; qsize = 0; head = 0; tail = 0; last_ts = 0; track_seq = 0; s = edgestate(); }
+		edgequeue(const edgestate& s1) { q = (unsigned char*)MAP_FAILED; sq = (uint64_t*)MAP_FAILED; width = 4; isize = 8; qsize = 0; head = 0; tail = 0; last_ts = 0; track_seq = 0; s = s1; }
+		~edgequeue() {
+			clean();
+		}
+		edgequeue(const edgequeue&) = delete;
+		edgequeue& operator = (const edgequeue&) = delete;
+		
+		//n. él időpontja
+		unsigned int& ts(uint64_t n) const { return *edgestate_ts(&s,n); }
+		
+		//i. elem (a ring bufferben) és részei
+		unsigned char* item(uint64_t i) const { return q + isize*(i & (qsize-1)); }
+		uint64_t item_e(const unsigned char* x) const { return edgeidx_get(x,width); }
+		uint32_t item_ts(const unsigned char* x) const { uint32_t t; memcpy(&t,x+width,4); return t; }
+		
+		//memória felszabadítása
+		void clean();
+		//tömb méretének duplázása (az első lefoglaláskor width és isize beállítása s.n alapján)
+		int grow();
+		//a már nem érvényes bejegyzések törlése (a sorrend nem változik) -- eredmény: a törölt elemek száma
+		uint64_t compact();
+		//a sor mérete legfeljebb ennyi lehet n él esetén (lásd fent)
+		static uint64_t max_size(uint64_t n) {
+			uint64_t size1 = 131072;
+			while(size1 < 2*n) size1 *= 2;
+			return size1;
+		}
+		
+		//e[n] hozzáadása a sor végére az aktuális időponttal (ts(n)) -- eredmény: 0, ha sikerült,
+		//	>0, ha hiba történt (nem sikerült a memóriát növelni, vagy az időpont kisebb, mint a korábbiak)
+		int add(uint64_t n) {
+			uint32_t t = ts(n);
+			if(t < last_ts || n >= s.n) return add_error(n);
+			if(tail - head == qsize) {
+				int r = make_room();
+				if(r) return r;
+			}
+			unsigned char* x = item(tail);
+			edgeidx_set(x,width,n);
+			memcpy(x+width,&t,4);
+			tail++;
+			last_ts = t;
+			return 0;
+		}
+		//ugyanez, seq sorszámmal (track_seq esetén)
+		int add(uint64_t n, uint64_t seq) {
+			int r = add(n);
+			if(!r) sq[(tail-1) & (qsize-1)] = seq;
+			return r;
+		}
+		
+		//a legrégebbi él, ha az időpontja time1 előtti: ekkor a sorból töröljük, az eredmény 1,
+		//	*n és *t az él sorszáma és időpontja; különben (nincs több lejárt él) 0 az eredmény
+		int pop(uint32_t time1, uint64_t* n, unsigned int* t) {
+			while(head != tail) {
+				const unsigned char* x = item(head);
+				uint32_t t1 = item_ts(x);
+				if(t1 >= time1) return 0;
+				head++;
+				uint64_t e = item_e(x);
+				if(ts(e) != t1) continue; //később újra aktív volt, ez a bejegyzés már nem érvényes
+				*n = e;
+				*t = t1;
+				return 1;
+			}
+			return 0;
+		}
+		//ugyanez, a sorszámot is visszaadva (track_seq esetén)
+		int pop(uint32_t time1, uint64_t* n, unsigned int* t, uint64_t* seq) {
+			while(head != tail) {
+				const unsigned char* x = item(head);
+				uint32_t t1 = item_ts(x);
+				if(t1 >= time1) return 0;
+				uint64_t seq1 = sq[head & (qsize-1)];
+				head++;
+				uint64_t e = item_e(x);
+				if(ts(e) != t1) continue;
+				*n = e;
+				*t = t1;
+				*seq = seq1;
+				return 1;
+			}
+			return 0;
+		}
+		
+	protected:
+		int add_error(uint64_t n);
+		//hely a következő elemnek, ha a sor tele van: compact(), és ha ez nem elég, grow()
+		int make_room();
+};
+
+#endif
+
@@ -26,6 +26,12 @@
 
 #include "edges.h"
 #include "read_table.h"
+#include "radix_sort.h"
+#include "chunkread.h"
+#include "iterator_zip.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 
 /*****************************************
  * élek rendezett tárolása (idő és élek) *
@@ -33,113 +39,105 @@
 
 static const uint64_t pagesize = 4096;
 
-//két él felcserélése (csak az ID-k, a sorbarendezés még a feldolgozás előtt történik)
-static inline void edges_swap(edge* e, uint64_t i, uint64_t j) {
-	unsigned int p1 = e[i].p1;
-	unsigned int p2 = e[i].p2;
-	e[i].p1 = e[j].p1;
-	e[i].p2 = e[j].p2;
-	e[j].p1 = p1;
-	e[j].p2 = p2;
+//két él felcserélése (a hozzájuk tartozó időpontokkal és tranzakció ID-kkel együtt)
+static inline void edges_swap(edges* e, uint64_t i, uint64_t j) {
+	edge tmp = e->e[i];
+	e->e[i] = e->e[j];
+	e->e[j] = tmp;
+	if(e->ts) std::swap(e->ts[i],e->ts[j]);
+	if(e->txid) std::swap(e->txid[i],e->txid[j]);
 }
 
-//quicksort az élek ID-k szerinti sorbarendezésére
-static void edges_sort(edge* d, uint64_t s, uint64_t e) {
-	if(s >= e) return;
-	if(e-s == 1) return;
-	if(e-s == 2) {
-		if(cmpedge2(d,s,s+1) < 0) edges_swap(d,s,s+1);
-		return;
-	}
-	
-	uint64_t p = s + (e-s)/2;
-	uint64_t i;
-	edges_swap(d,p,e-1);
-	p = s;
-	for(i=s;i<e-1;i++) {
-		int a = cmpedge2(d,e-1,i);
-		if(a == -1 || (a == 0 && p<s+(e-s)/2) ) {
-			if(i>p) edges_swap(d,i,p);
-			p++;
-		}
-	}
-	if(p < e-1) edges_swap(d,p,e-1);
-	edges_sort(d,s,p);
-	edges_sort(d,p+1,e);
+//radix sort az élek ID-k szerinti sorbarendezésére (edgehash szerint, lásd radix_sort.h)
+static void edges_sort(edges* e) {
+	if(e->nedges < 2) return;
+	const edge* d = e->e;
+	radix_sort(e->nedges, sizeof(edgekey), [d](size_t i, unsigned int level) {
+			return (unsigned int)((edgehash(d,i) >> (8*(sizeof(edgekey) - 1 - level))) & 0xffU); },
+		[e](size_t i, size_t j) { edges_swap(e,i,j); },
+		[d](size_t i, size_t j) { return edgehash(d,i) < edgehash(d,j); });
 }
 
 void edges_sort1(edges* e) {
 	if(!e) return;
 	if(!(e->e)) return;
-	edges_sort(e->e,0,e->nedges);
+	edges_sort(e);
+}
+
+//többször előforduló élek törlése rendezés után (az elsőt tartjuk meg); az időpontok és a
+//	tranzakció ID-k külön tömbökben vannak, ezeket együtt mozgatjuk (zip iterátorral)
+template<class It>
+static uint64_t edges_unique0(It it, uint64_t n) {
+	return std::unique(it, it + n, [](const auto& x, const auto& y) {
+		const edge& e1 = std::get<0>(x);
+		const edge& e2 = std::get<0>(y);
+		return e1.p1 == e2.p1 && e1.p2 == e2.p2; }) - it;
+}
+static void edges_unique(edges* e) {
+	if(e->ts && e->txid) e->nedges = edges_unique0(zi::make_zip_itn(e->e,e->ts,e->txid),e->nedges);
+	else if(e->ts) e->nedges = edges_unique0(zi::make_zip_itn(e->e,e->ts),e->nedges);
+	else if(e->txid) e->nedges = edges_unique0(zi::make_zip_itn(e->e,e->txid),e->nedges);
+	else e->nedges = edges_unique0(zi::make_zip_itn(e->e),e->nedges);
 }
 
 
 
 //idő szerinti rendezés
-static inline int edges_tcmp(edge* e, uint64_t i, uint64_t j) {
-	if(e[i].timestamp < e[j].timestamp) return 1;
-	if(e[i].timestamp > e[j].timestamp) return -1;
-	uint64_t eh1 = edgehash(e,i);
-	uint64_t eh2 = edgehash(e,j);
+static inline int edges_tcmp(const edges* e, uint64_t i, uint64_t j) {
+	if(e->ts[i] < e->ts[j]) return 1;
+	if(e->ts[i] > e->ts[j]) return -1;
+	edgekey eh1 = edgehash(e->e,i);
+	edgekey eh2 = edgehash(e->e,j);
 	if(eh1 < eh2) return 1;
 	if(eh1 > eh2) return -1;
 	return 0;
 }
 
-//két él felcserélése (csak az ID-k, a sorbarendezés még a feldolgozás előtt történik)
-static inline void edges_tswap(edge* e, uint64_t i, uint64_t j) {
-	unsigned int p1 = e[i].p1;
-	unsigned int p2 = e[i].p2;
-	unsigned int t = e[i].timestamp;
-	e[i].p1 = e[j].p1;
-	e[i].p2 = e[j].p2;
-	e[i].timestamp = e[j].timestamp;
-	e[j].p1 = p1;
-	e[j].p2 = p2;
-	e[j].timestamp = t;
-}
-
-//quicksort az élek idő szerinti sorbarendezésére
-static void edges_tsort(edge* d, uint64_t s, uint64_t e) {
-	if(s >= e) return;
-	if(e-s == 1) return;
-	if(e-s == 2) {
-		if(edges_tcmp(d,s,s+1) < 0) edges_tswap(d,s,s+1);
-		return;
-	}
-	
-	uint64_t p = s + (e-s)/2;
-	uint64_t i;
-	edges_tswap(d,p,e-1);
-	p = s;
-	for(i=s;i<e-1;i++) {
-		int a = edges_tcmp(d,e-1,i);
-		if(a == -1 || (a == 0 && i<s+(e-s)/2) ) {
-			if(i>p) edges_tswap(d,i,p);
-			p++;
-		}
-	}
-	if(p < e-1) edges_tswap(d,p,e-1);
-	edges_tsort(d,s,p);
-	edges_tsort(d,p+1,e);
+//radix sort az élek idő szerinti sorbarendezésére: a kulcs 12 bájtos (timestamp, majd edgehash;
+//	20 bájtos 64 bites ID-k esetén)
+static void edges_tsort(edges* e) {
+	if(e->nedges < 2 || !e->ts) return;
+	radix_sort(e->nedges, 4 + sizeof(edgekey), [e](size_t i, unsigned int level) {
+			if(level < 4) return (unsigned int)((e->ts[i] >> (24 - 8*level)) & 0xffU);
+			return (unsigned int)((edgehash(e->e,i) >> (8*(sizeof(edgekey) + 3 - level))) & 0xffU);
+		},
+		[e](size_t i, size_t j) { edges_swap(e,i,j); },
+		[e](size_t i, size_t j) { return edges_tcmp(e,i,j) == 1; });
 }
 
 void edges_tsort1(edges* e) {
 	if(!e) return;
 	if(!(e->e)) return;
-	edges_tsort(e->e,0,e->nedges);
+	edges_tsort(e);
 }
 
 
-const static uint64_t grow_size0 = 4194304UL; //4M darab él, 16k page, 64MiB memória
+const static uint64_t grow_size0 = 4194304UL; //4M darab él, 8k page, 32MiB memória
+
+//az élekhez tartozó további tömb (időpontok vagy tranzakció ID-k) növesztése, ha létezik
+//	(ha *a == 0, akkor nincs ilyen adat, nem csinálunk semmit)
+static int edges_grow_array(unsigned int** a, uint64_t old_size, uint64_t new_size) {
+	if(!*a) return 0;
+	void* ptr2 = memplace_mremap(*a,old_size*sizeof(unsigned int),new_size*sizeof(unsigned int));
+	if(ptr2 == MAP_FAILED) return 1;
+	*a = (unsigned int*)ptr2;
+	return 0;
+}
+
+//további tömb lefoglalása az élekhez (időpontok vagy tranzakció ID-k)
+static int edges_alloc_array(unsigned int** a, uint64_t size) {
+	void* ptr2 = memplace_mmap((size ? size : 1)*sizeof(unsigned int));
+	if(ptr2 == MAP_FAILED) return 1;
+	*a = (unsigned int*)ptr2;
+	return 0;
+}
 static edges* edges_grow0(edges* e, uint64_t size1) {
 	edges* e2 = e;
 	if(!size1) {
 		if(e) size1 = e->edges_grow;
 		else size1 = grow_size0;
 	}
-	uint64_t s1 = pagesize/sizeof(edge); //!! feltesszük, hogy a pagesize osztható az élek méretével (a jelenlegi változatban teljesül)
+	uint64_t s1 = pagesize/sizeof(unsigned int); //így az élek és a további tömbök mérete is a pagesize többszöröse
 	uint64_t s2 = size1%s1;
 	if(s2) {
 		size1 -= s2;
@@ -150,9 +148,14 @@ static edges* edges_grow0(edges* e, uint64_t size1) {
 		e = (edges*)malloc(sizeof(edges));
 		if(!e) return 0;
 		e->e = (edge*)MAP_FAILED;
+		e->ts = 0;
+		e->txid = 0;
 		e->edges_size = 0;
 		e->edges_grow = grow_size0;
 		e->h = 0;
+		e->hi = 0;
+		e->ef = 0;
+		e->dense = 0;
 	}
 	uint64_t map_size = (size1)*sizeof(edge);
 	uint64_t old_size = (e->edges_size)*sizeof(edge);
@@ -161,16 +164,21 @@ static edges* edges_grow0(edges* e, uint64_t size1) {
 			fprintf(stderr,"edges_grow(): hibás adatok!\n");
 			return 0; //hiba
 		}
-		void* ptr2 = mremap(e->e,old_size,old_size+map_size,MREMAP_MAYMOVE);
+		void* ptr2 = memplace_mremap(e->e,old_size,old_size+map_size);
 		if(ptr2 == MAP_FAILED) {
 			fprintf(stderr,"edges_grow(): nincs elég memória!\n");
 			return 0;
 		}
 		e->e = (edge*)ptr2;
+		if(edges_grow_array(&(e->ts),e->edges_size,e->edges_size+size1) ||
+				edges_grow_array(&(e->txid),e->edges_size,e->edges_size+size1)) {
+			fprintf(stderr,"edges_grow(): nincs elég memória!\n");
+			return 0;
+		}
 		e->edges_size += size1;
 	}
 	else {
-		void* ptr2 = mmap(0,map_size,PROT_READ | PROT_WRITE,MAP_ANONYMOUS | MAP_PRIVATE,-1,0);
+		void* ptr2 = memplace_mmap(map_size);
 		if(ptr2 == MAP_FAILED) {
 			fprintf(stderr,"edges_grow(): nincs elég memória!\n");
 			if(!e2) free(e);
@@ -187,21 +195,78 @@ edges* edges_grow(edges* e) {
 	return edges_grow0(e,0);
 }
 
+int edgestate_init(edgestate* s, const edges* e, int flags) {
+	s->n = e->nedges;
+	s->ts = 0;
+	s->off = 0;
+	s->seen = 0;
+	s->off_width = edgeidx_width(e->nedges);
+	if(e->nedges > EDGEIDX_MAX) {
+		fprintf(stderr,"edgestate_init(): too many edges!\n");
+		return 1;
+	}
+	uint64_t map_size = (e->nedges ? e->nedges : 1)*sizeof(unsigned int);
+	if(flags & EDGESTATE_TS) {
+		void* ptr1 = memplace_mmap(map_size);
+		if(ptr1 == MAP_FAILED) goto edgestate_init_error;
+		s->ts = (unsigned int*)ptr1;
+	}
+	if(flags & EDGESTATE_OFF) {
+		void* ptr2 = memplace_mmap((e->nedges ? e->nedges : 1)*s->off_width);
+		if(ptr2 == MAP_FAILED) goto edgestate_init_error;
+		s->off = (unsigned char*)ptr2;
+	}
+	if(flags & EDGESTATE_SEEN) {
+		s->seen = (uint64_t*)memplace_alloc((e->nedges/64 + 1)*sizeof(uint64_t));
+		if(!s->seen) goto edgestate_init_error;
+	}
+	return 0;
+	
+edgestate_init_error:
+	fprintf(stderr,"edgestate_init(): nincs elég memória!\n");
+	edgestate_free(s);
+	return 1;
+}
+
+void edgestate_free(edgestate* s) {
+	uint64_t map_size = (s->n ? s->n : 1)*sizeof(unsigned int);
+	if(s->ts) memplace_munmap(s->ts,map_size);
+	if(s->off) memplace_munmap(s->off,(s->n ? s->n : 1)*s->off_width);
+	if(s->seen) memplace_free(s->seen);
+	s->ts = 0;
+	s->off = 0;
+	s->seen = 0;
+}
+
 void edges_free(edges* e) {
 	if(e) {
 		if(e->e != MAP_FAILED) {
 			if(e->edges_size == 0) {
 				fprintf(stderr,"edges_free(): hibás adatok!\n");
 			}
-			munmap(e->e,(e->edges_size)*sizeof(edge));
+			memplace_munmap(e->e,(e->edges_size)*sizeof(edge));
+			if(e->ts) memplace_munmap(e->ts,(e->edges_size)*sizeof(unsigned int));
+			if(e->txid) memplace_munmap(e->txid,(e->edges_size)*sizeof(unsigned int));
 			e->e = (edge*)MAP_FAILED;
+			e->ts = 0;
+			e->txid = 0;
 			e->edges_size = 0;
 		}
 		if(e->h) {
-			if(e->h->index) free(e->h->index);
-			if(e->h->outdeg) free(e->h->outdeg);
+			if(e->h->off) {
+				if(e->h->mapped) munmap(e->h->off,e->h->size);
+				else memplace_free(e->h->off);
+			}
 			free(e->h);
 		}
+		if(e->hi) {
+			memplace_munmap(e->hi->slots,e->hi->width*(e->hi->mask+1));
+			free(e->hi);
+		}
+		if(e->ef) {
+			edgeef_free(e->ef);
+			free(e->ef);
+		}
 		free(e);
 	}
 }
@@ -212,58 +277,68 @@ void edges_free(edges* e) {
 #define EFLAGS_T1 1 //időpontokat is beolvasunk és idő szerint rendezzük az eredményt (ha nincs megadva, akkor csak
 	//éleket olvasunk be és minden élből csak egyet tartunk meg)
 #define EFLAGS_SELF 2 //megengedünk önmagába mutató éleket (p1->p1)
-#define EFLAGS_TXID 4 //tranzakció ID-ket is beolvasunk (legutolsó oszlop, az offset tömbbe tároljuk el) 
+#define EFLAGS_TXID 4 //tranzakció ID-ket is beolvasunk (legutolsó oszlop, a txid tömbbe tároljuk el) 
 #define EFLAGS_ERROR_OVERFLOW 8 // overflow hibát jelent (különben csak kihagyjuk)
 */
-edges* edges_read0(FILE* f, int flags) {
-	edges* e = edges_grow(0);
-	if(!e) {
-		fprintf(stderr,"edges_read(): nem sikerült memóriát lefoglalni!\n");
-		return 0;
+//beolvasás közben talált hibák (közös az összes szálban)
+struct edges_read_errors {
+	std::atomic<uint64_t> n{0};
+	std::mutex m;
+};
+
+static const uint64_t edges_read_mh = 20; //ennyi hibát írunk ki
+
+static void edges_read_error(edges_read_errors& err, const read_table* rt, const char* msg) {
+	uint64_t n = err.n++;
+	if(n < edges_read_mh) {
+		std::unique_lock<std::mutex> lock(err.m);
+		fprintf(stderr,"edges_read(): hibás adatok a bement %lu. sorában%s!\n",rt->line,msg);
+		read_table_write_error(rt,stderr);
+		if(n + 1 == edges_read_mh) fprintf(stderr,"\t(a további hibákat már nem írom ki)\n");
 	}
-	
+}
+
+//a bemenet egy része (lásd chunkread.h) beolvasva
+struct edges_chunk {
+	std::vector<edge> e;
+	std::vector<unsigned int> ts; //időpontok (EFLAGS_T1)
+	std::vector<unsigned int> txid; //tranzakció ID-k (EFLAGS_TXID)
+	uint32_t tlast = 0; //utolsó időpont
+	int sorted = 1;
+	int tsorted = 1;
+};
+
+//egy rész feldolgozása, ugyanúgy, mint ha a teljes fájlt olvasnánk soronként
+static int edges_read_chunk(const char* buf, size_t len, uint64_t line0, int flags,
+		edges_chunk& c, edges_read_errors& err) {
 	read_table rt;
-	read_table_init(&rt,f);
+	FILE* f;
+	if(chunkread_table(buf,len,line0,&rt,&f)) return 1;
 	read_table_set_comment(&rt,'#');
 	
 	//bemeneti fájl: egy sorban két ID csak
-	uint64_t hiba = 0;
-	uint64_t mh = 20;
-	uint64_t sor = 0;
-	uint64_t last = 0; //legutóbbi beolvasott él (minden él csak egyszer lehet)
-	uint32_t tlast = 0; //legutóbbi időpont
-	int sorted = 1; //ha nincs rendezve a fájl, akkor rendezzük
-	int tsorted = 1; //időbeli rendezettség ellenőrzése
+	edgekey last = 0; //legutóbbi beolvasott él (minden él csak egyszer lehet)
+	c.e.reserve(len / 16);
 	while(1) {
 		int a;
-		uint32_t a1,a2,timestamp;
+		nodeid a1,a2;
+		uint32_t timestamp = 0;
 		
 		if(read_table_line(&rt)) break;
-		sor++;
 		
-		a = read_table_uint32(&rt,&a1);
-		if(a == 0) a = read_table_uint32(&rt,&a2);
+		a = read_table_next(&rt,a1);
+		if(a == 0) a = read_table_next(&rt,a2);
 		if(a) {
 			if(read_table_get_last_error(&rt) == T_EOF) break;
 			if(read_table_get_last_error(&rt) == T_OVERFLOW && !(flags & EFLAGS_ERROR_OVERFLOW)) continue;
-			if(hiba < mh) {
-				fprintf(stderr,"edges_read(): hibás adatok a bement %lu. sorában!\n",sor);
-				read_table_write_error(&rt,stderr);
-			}
-			hiba++;
-			if(hiba == mh) fprintf(stderr,"\t(a további hibákat már nem írom ki)\n");
+			edges_read_error(err,&rt,"");
 			continue;
 		}
 		
 		if(flags & EFLAGS_T1) {
 			a = read_table_uint32(&rt,&timestamp);
 			if(a) {
-				if(hiba < mh) {
-					fprintf(stderr,"edges_read(): hibás adatok a bement %lu. sorában (nincs időpont megadva)!\n",sor);
-					read_table_write_error(&rt,stderr);
-				}
-				hiba++;
-				if(hiba == mh) fprintf(stderr,"\t(a további hibákat már nem írom ki)\n");
+				edges_read_error(err,&rt," (nincs időpont megadva)");
 				continue;
 			}
 		}
@@ -271,73 +346,117 @@ edges* edges_read0(FILE* f, int flags) {
 		if(a1 == a2) if(!(flags & EFLAGS_SELF)) continue; //önmagába mutató éleket kihagyjuk
 		
 		//a1,a2 két érvényes ID
-		if(e->nedges == e->edges_size) {
-			edges* e2 = edges_grow(e);
-			if(!e2) {
-				fprintf(stderr,"edges_read(): nem sikerült memóriát lefoglalni!\n");
-				break;
-			}
-		}
-		
-		edge* e1 = e->e + e->nedges;
-		e1->p1 = a1;
-		e1->p2 = a2;
+		edge e1;
+		e1.p1 = a1;
+		e1.p2 = a2;
+		unsigned int txid = 0;
 		if(flags & EFLAGS_T1) {
-			e1->timestamp = timestamp;
-			if(timestamp < tlast) tsorted = 0;
+			if(timestamp < c.tlast) c.tsorted = 0;
+			c.tlast = timestamp;
 		}
-		else e1->timestamp = 0;
 		
 		if(flags & EFLAGS_TXID) { //tranzakció ID eltárolása
-			unsigned int txid;
 			a = read_table_uint32(&rt,&txid);
 			if(a) {
-				if(hiba < mh) {
-					fprintf(stderr,"edges_read(): hibás adatok a bement %lu. sorában (nincs tranzakció ID megadva)!\n",sor);
-					read_table_write_error(&rt,stderr);
-				}
-				hiba++;
-				if(hiba == mh) fprintf(stderr,"\t(a további hibákat már nem írom ki)\n");
+				edges_read_error(err,&rt," (nincs tranzakció ID megadva)");
 				continue;
 			}
-			e1->offset = txid;
 		}
 		
-		uint64_t eh2 = edgehash(e1,0);
+		edgekey eh2 = edgehash(&e1,0);
 		if(eh2 < last) {
-			sorted = 0; //megengedjük, hogy ne legyen sorbarendezve a fájl, ekkor rendezzük
+			c.sorted = 0; //megengedjük, hogy ne legyen sorbarendezve a fájl, ekkor rendezzük
 		}
 		if(eh2 == last) {
 			if(!(flags & EFLAGS_T1)) continue; //a duplán előforduló elemeket átugorjuk
 		}
 		
-		e->nedges += 1;
-		last = eh2;		
+		c.e.push_back(e1);
+		if(flags & EFLAGS_T1) c.ts.push_back(timestamp);
+		if(flags & EFLAGS_TXID) c.txid.push_back(txid);
+		last = eh2;
+	}
+	int ret = 0;
+	if(read_table_get_last_error(&rt) != T_EOF) ret = 1;
+	if(rt.buf) free(rt.buf);
+	fclose(f);
+	return ret;
+}
+
+/* a fájl részenként, párhuzamosan van feldolgozva (nthreads szálon, lásd chunkread.h),
+ * a részek eredményét sorrendben fűzzük össze, itt ellenőrizzük a részek határán
+ * is a rendezettséget és a duplán előforduló éleket */
+edges* edges_read0(FILE* f, int flags, unsigned int nthreads) {
+	edges* e = edges_grow(0);
+	if(!e) {
+		fprintf(stderr,"edges_read(): nem sikerült memóriát lefoglalni!\n");
+		return 0;
 	}
-	if(hiba) fprintf(stderr,"edges_read(): összesen %lu hibás sor\n",hiba);
 	
-	if(!(sorted || (flags & EFLAGS_T1) )) { //ha időpontokkal együtt olvastuk be, akkor nem rendezzük újra
-		edges_sort(e->e,0,e->nedges);
-		//lehetnek többször előforduló élek, ezekből egyet tartunk csak meg
-		uint64_t i,j=0;
-		uint64_t ehl = edgehash(e->e,0);
-		for(i=1;i<e->nedges;i++) {
-			uint64_t eh2 = edgehash(e->e,i);
-			if(eh2 != ehl) {
-				j++;
-				if(j!=i) {
-					e->e[j].p1 = e->e[i].p1;
-					e->e[j].p2 = e->e[i].p2;
+	if(((flags & EFLAGS_T1) && edges_alloc_array(&(e->ts),e->edges_size)) ||
+			((flags & EFLAGS_TXID) && edges_alloc_array(&(e->txid),e->edges_size))) {
+		fprintf(stderr,"edges_read(): nem sikerült memóriát lefoglalni!\n");
+		edges_free(e);
+		return 0;
+	}
+	
+	edges_read_errors err;
+	edgekey last = 0; //legutóbbi beolvasott él (minden él csak egyszer lehet)
+	uint32_t tlast = 0; //legutóbbi időpont
+	int sorted = 1; //ha nincs rendezve a fájl, akkor rendezzük
+	int tsorted = 1; //időbeli rendezettség ellenőrzése
+	
+	int r = chunkread<edges_chunk>(f,
+		[flags,&err](const char* buf, size_t len, uint64_t line0, edges_chunk& c) {
+			return edges_read_chunk(buf,len,line0,flags,c,err);
+		},
+		[flags,e,&last,&tlast,&sorted,&tsorted](edges_chunk& c) {
+			if(!c.sorted) sorted = 0;
+			if(!c.tsorted) tsorted = 0;
+			if(c.e.empty()) return 0;
+			size_t i = 0;
+			edgekey eh1 = edgehash(c.e.data(),0);
+			if(eh1 < last) sorted = 0;
+			if(eh1 == last && !(flags & EFLAGS_T1)) i = 1; //duplán előforduló él a két rész határán
+			if((flags & EFLAGS_T1) && c.ts[0] < tlast) tsorted = 0;
+			last = edgehash(c.e.data(),c.e.size()-1);
+			tlast = c.tlast;
+			
+			uint64_t n = c.e.size() - i;
+			while(e->nedges + n > e->edges_size) {
+				edges* e2 = edges_grow(e);
+				if(!e2) {
+					fprintf(stderr,"edges_read(): nem sikerült memóriát lefoglalni!\n");
+					return 1;
 				}
-				ehl = eh2;
 			}
-		}
-		e->nedges = j+1;
+			memcpy(e->e + e->nedges, c.e.data() + i, n*sizeof(edge));
+			if(e->ts) memcpy(e->ts + e->nedges, c.ts.data() + i, n*sizeof(unsigned int));
+			if(e->txid) memcpy(e->txid + e->nedges, c.txid.data() + i, n*sizeof(unsigned int));
+			e->nedges += n;
+			std::vector<edge>().swap(c.e);
+			std::vector<unsigned int>().swap(c.ts);
+			std::vector<unsigned int>().swap(c.txid);
+			return 0;
+		}, nthreads);
+	if(r < 0) {
+		fprintf(stderr,"edges_read(): hiba a bemenet olvasásakor!\n");
+		edges_free(e);
+		return 0;
+	}
+	
+	uint64_t hiba = err.n;
+	if(hiba) fprintf(stderr,"edges_read(): összesen %lu hibás sor\n",hiba);
+	
+	if(!(sorted || (flags & EFLAGS_T1) ) && e->nedges) { //ha időpontokkal együtt olvastuk be, akkor nem rendezzük újra
+		edges_sort(e);
+		//lehetnek többször előforduló élek, ezekből egyet tartunk csak meg
+		edges_unique(e);
 	}
 	
 	//idő szerinti sorbarendezés
 	if((flags & EFLAGS_T1) && !tsorted) {
-		edges_tsort(e->e,0,e->nedges);
+		edges_tsort(e);
 	}
 	
 	//felesleges memória felszabadítása
@@ -358,35 +477,43 @@ edges* edges_read0(FILE* f, int flags) {
 	return e;
 }
 
-edges* edges_read(FILE* f) {
-	return edges_read0(f,0);
+edges* edges_read(FILE* f, unsigned int nthreads) {
+	return edges_read0(f,0,nthreads);
 }
 
-edges* edges_read2(FILE* f) {
-	return edges_read0(f,EFLAGS_T1);
+edges* edges_read2(FILE* f, unsigned int nthreads) {
+	return edges_read0(f,EFLAGS_T1,nthreads);
 }
 
 
 //élek átmásolása egy új tömbbe, ha r == 1, akkor fordítva (p2->p1, p1->p2)
-edges* edges_copy(edges* e1, int r) {
-	if(!e1) return 0;
-	edges* e = edges_grow0(0,e1->nedges);
+//az e1 élek [start,end) részének átmásolása egy új struktúrába (r == 1: fordított élek);
+//	a tömbök külön-külön, folytonosan másolhatók
+static edges* edges_copy0(const edges* e1, uint64_t start, uint64_t end, int r) {
+	uint64_t N = end-start;
+	edges* e = edges_grow0(0,N);
 	if(!e) return 0;
-	uint64_t i;
-	if(r) for(i=0;i<e1->nedges;i++) {
-		e->e[i].p1 = e1->e[i].p2;
-		e->e[i].p2 = e1->e[i].p1;
-		e->e[i].timestamp = e1->e[i].timestamp;
-		e->e[i].offset = 0;
-	}
-	else for(i=0;i<e1->nedges;i++) {
-		e->e[i].p1 = e1->e[i].p1;
-		e->e[i].p2 = e1->e[i].p2;
-		e->e[i].timestamp = e1->e[i].timestamp;
-		e->e[i].offset = 0;
+	if(e1->ts && edges_alloc_array(&(e->ts),e->edges_size)) {
+		edges_free(e);
+		return 0;
 	}
+	if(r) std::transform(e1->e + start, e1->e + end, e->e, [](const edge& x) {
+		edge y;
+		y.p1 = x.p2;
+		y.p2 = x.p1;
+		return y; });
+	else std::copy(e1->e + start, e1->e + end, e->e);
+	if(e->ts) std::copy(e1->ts + start, e1->ts + end, e->ts);
 	
-	e->nedges = e1->nedges;
+	e->nedges = N;
+	e->dense = e1->dense;
+	return e;
+}
+
+edges* edges_copy(edges* e1, int r) {
+	if(!e1) return 0;
+	edges* e = edges_copy0(e1,0,e1->nedges,r);
+	if(!e) return 0;
 	
 	if(r) edges_sort1(e);
 	return e;
@@ -396,62 +523,66 @@ edges* edges_copy(edges* e1, int r) {
 edges* edges_copy2(edges* e1, uint64_t start, uint64_t end, int r) {
 	if(!e1) return 0;
 	if(start >= e1->nedges || end >= e1->nedges || end <= start) return 0;
-	uint64_t N = end-start;
-	edges* e = edges_grow0(0,N);
+	edges* e = edges_copy0(e1,start,end,r);
 	if(!e) return 0;
-	uint64_t i;
-	if(r) for(i=0;i<N;i++) {
-		e->e[i].p1 = e1->e[i+start].p2;
-		e->e[i].p2 = e1->e[i+start].p1;
-		e->e[i].timestamp = e1->e[i+start].timestamp;
-		e->e[i].offset = 0;
-	}
-	else for(i=0;i<N;i++) {
-		e->e[i].p1 = e1->e[i+start].p1;
-		e->e[i].p2 = e1->e[i+start].p2;
-		e->e[i].timestamp = e1->e[i+start].timestamp;
-		e->e[i].offset = 0;
-	}
-	
-	e->nedges = N;
 	
-	//~ if(r) edges_sort1(e);
-	//~ if(!(sorted || (flags & EFLAGS_T1) )) { //ha időpontokkal együtt olvastuk be, akkor nem rendezzük újra
-		edges_sort(e->e,0,e->nedges);
-		//lehetnek többször előforduló élek, ezekből egyet tartunk csak meg
-		uint64_t j=0;
-		uint64_t ehl = edgehash(e->e,0);
-		for(i=1;i<e->nedges;i++) {
-			uint64_t eh2 = edgehash(e->e,i);
-			if(eh2 != ehl) {
-				j++;
-				if(j!=i) {
-					e->e[j].p1 = e->e[i].p1;
-					e->e[j].p2 = e->e[i].p2;
-				}
-				ehl = eh2;
-			}
-		}
-		e->nedges = j+1;
-	//~ }
+	edges_sort(e);
+	//lehetnek többször előforduló élek, ezekből egyet tartunk csak meg
+	edges_unique(e);
 	return e;
 }
 
+static inline void edgehelper_set(edgehelper* h, uint64_t i, uint64_t x) {
+	if(h->width == 4) ((uint32_t*)(h->off))[i] = (uint32_t)x;
+	else memcpy(h->off + 5*i, &x, 5); //little endian
+}
+
+//él keresése a [s,end) tartományban (itt p1 kimenő élei vannak, de előtte lehetnek
+//	olyan élek is, amelyek p1-e nem szerepel az ID-k között)
+static inline uint64_t edges_find_range(const edges* e, uint64_t s, uint64_t end, nodeid p1, nodeid p2) {
+	const edge* e1 = e->e;
+	uint64_t r = e->nedges;
+	if(end - s <= EDGEHELPER_SCAN) {
+		//kevés él: lineáris keresés, elágazás nélkül (minden él csak egyszer szerepel)
+		for(;s<end;s++) r = (e1[s].p1 == p1 && e1[s].p2 == p2) ? s : r;
+		return r;
+	}
+	//sok kimenő él ("hub"): bináris keresés
+	edgekey eh2 = edgekey_make(p1,p2);
+	uint64_t end0 = end;
+	while(s < end) {
+		uint64_t mid = s + (end - s)/2;
+		if(edgehash(e1,mid) < eh2) s = mid + 1;
+		else end = mid;
+	}
+	if(s < end0 && edgehash(e1,s) == eh2) r = s;
+	return r;
+}
+
 //él megkeresése
-uint64_t edges_find(edges* e, uint32_t p1, uint32_t p2) {
+uint64_t edges_find(edges* e, nodeid p1, nodeid p2) {
+	if(e->ef) return edgeef_find(e->ef,p1,p2);
+	if(e->hi) {
+		edgekey eh2 = edgekey_make(p1,p2);
+		uint64_t h = edgeindex_hash(eh2) & e->hi->mask;
+		const uint64_t empty = edgeidx_empty(e->hi->width);
+		while(1) {
+			uint64_t i = edgeindex_slot(e->hi,h);
+			if(i == empty) return e->nedges;
+			if(edgehash(e->e,i) == eh2) return i;
+			h = (h + 1) & e->hi->mask;
+		}
+	}
+	if(e->h) {
+		nodeid i1 = e->dense ? p1 : ids_find2(e->h->il,p1);
+		if(i1 < e->h->N) return edges_find_range(e, edgehelper_off(e->h,i1), edgehelper_off(e->h,i1+1), p1, p2);
+	}
 	edge e2;
 	e2.p1 = p1;
 	e2.p2 = p2;
-	uint64_t eh2 = edgehash(&e2,0); //keresés ez alapján
+	edgekey eh2 = edgehash(&e2,0); //keresés ez alapján
 	uint64_t i = 0; //"tipp"
 	uint64_t di = e->nedges;
-	if(e->h) {
-		unsigned int i1 = ids_find2(e->h->il,p1);
-		if(i1 < e->h->il->N) {
-			i = e->h->index[i1];
-			di = e->h->outdeg[i1];
-		}
-	}
 	int found = 0;
 	while(1) {
 		int r = cmpedge(e->e,i,eh2);
@@ -482,14 +613,14 @@ uint64_t edges_find(edges* e, uint32_t p1, uint32_t p2) {
 }
 
 
-static inline int cmpf(edge* e, uint64_t i, uint32_t p1) {
+static inline int cmpf(edge* e, uint64_t i, nodeid p1) {
 	if(p1 < e[i].p1) return -1;
 	if(p1 > e[i].p1) return 1;
 	return 0;
 }
 
 //olyan él keresése, ahol az első ID megegyezik a megadottal
-uint64_t edges_findfirst(edges* e, uint32_t p1) {
+uint64_t edges_findfirst(edges* e, nodeid p1) {
 	uint64_t i = 0; //"tipp"
 	uint64_t di = e->nedges; //!! e->nedges uint64_t típus
 	int found = 0;
@@ -526,50 +657,184 @@ uint64_t edges_findfirst(edges* e, uint32_t p1) {
 int edges_createhelper(edges* e, const idlist* il) {
 	if(!(e && il)) return 1;
 	if(!(e->nedges && e->e)) return 1;
-	if(e->nedges > UINT_MAX) {
-		fprintf(stderr,"edges_createhelper(): too many edges!\n");
-		return 4;
-	}
 	if(!(il->N && il->ids)) return 1;
 	if(e->h) {
-		if(e->h->index) { free(e->h->index); e->h->index = 0; }
-		if(e->h->outdeg) { free(e->h->outdeg); e->h->outdeg = 0; }
+		if(e->h->off) {
+			if(e->h->mapped) munmap(e->h->off,e->h->size);
+			else memplace_free(e->h->off);
+			e->h->off = 0;
+		}
 	}
 	else {
 		e->h = (edgehelper*)malloc(sizeof(edgehelper));
 		if(!e->h) return 2;
 	}
 	e->h->il = il;
-	e->h->index = (uint64_t*)malloc(sizeof(uint64_t)*(il->N));
-	e->h->outdeg = (uint64_t*)malloc(sizeof(uint64_t)*(il->N));
-	if( ! (e->h->index && e->h->outdeg) ) {
-		if(e->h->index) free(e->h->index);
-		if(e->h->outdeg) free(e->h->outdeg);
+	e->h->N = il->N;
+	e->h->width = (e->nedges > UINT_MAX) ? 5 : 4;
+	//+8 bájt, hogy a 40 bites elemeket 64 bitesként lehessen olvasni
+	e->h->size = e->h->width*(il->N + 1) + sizeof(uint64_t);
+	e->h->mapped = 0;
+	e->h->off = (unsigned char*)memplace_alloc(e->h->size);
+	if(!e->h->off) {
 		free(e->h);
 		e->h = 0;
 		return 3;
 	}
-	int32_t last = e->e[0].p1;
-	uint64_t lastindex = 0;
-	uint64_t deg = 1;
-	uint64_t j;
-	for(j=1;j<e->nedges;j++) {
-		if(e->e[j].p1 != last) {
-			unsigned int i = ids_find2(il,last);
-			if(i < il->N) {
-				e->h->index[i] = lastindex;
-				e->h->outdeg[i] = deg;
-			}
-			last = e->e[j].p1;
-			lastindex = j;
-			deg = 0;
+	
+	//az élek p1 szerint, az ID-k (il->ids) növekvő sorrendben vannak, így egyszerre lehet
+	//	végigmenni rajtuk keresés nélkül; a pontok sorszáma megegyezik az il-beli sorszámukkal
+	uint64_t j = 0; //aktuális él
+	nodeid i;
+	for(i=0;i<il->N;i++) {
+		nodeid id = e->dense ? i : il->ids[i];
+		while(j < e->nedges && e->e[j].p1 < id) j++; //il-ben nem szereplő ID-k éleit kihagyjuk
+		edgehelper_set(e->h,i,j);
+		while(j < e->nedges && e->e[j].p1 == id) j++;
+	}
+	edgehelper_set(e->h,il->N,j);
+	return 0;
+}
+
+
+int edges_createindex(edges* e) {
+	if(!(e && e->e && e->nedges)) return 1;
+	if(e->nedges > EDGEIDX_MAX) {
+		fprintf(stderr,"edges_createindex(): too many edges!\n");
+		return 4;
+	}
+	if(e->hi) memplace_munmap(e->hi->slots,e->hi->width*(e->hi->mask+1));
+	else {
+		e->hi = (edgeindex*)malloc(sizeof(edgeindex));
+		if(!e->hi) return 2;
+	}
+	uint64_t size = 1024;
+	while(size < e->nedges + e->nedges/3) size *= 2; //legfeljebb 75%-os kitöltés
+	unsigned int width = edgeidx_width(e->nedges);
+	void* ptr = memplace_mmap(width*size);
+	if(ptr == MAP_FAILED) {
+		fprintf(stderr,"edges_createindex(): nincs elég memória!\n");
+		free(e->hi);
+		e->hi = 0;
+		return 3;
+	}
+	e->hi->slots = (unsigned char*)ptr;
+	e->hi->mask = size - 1;
+	e->hi->width = width;
+	memset(e->hi->slots,0xFF,width*size);
+	const uint64_t empty = edgeidx_empty(width);
+	uint64_t i;
+	for(i=0;i<e->nedges;i++) {
+		uint64_t h = edgeindex_hash(edgehash(e->e,i)) & e->hi->mask;
+		while(edgeindex_slot(e->hi,h) != empty) h = (h + 1) & e->hi->mask;
+		edgeidx_set(e->hi->slots + width*h, width, i);
+	}
+	return 0;
+}
+
+
+int edges_compress(edges* e, const idlist* il) {
+	if(!(e && il && e->e != MAP_FAILED && e->nedges) || e->ef || e->ts || e->txid) return 1;
+	if(il->N > UINT32_MAX) {
+		fprintf(stderr,"edges_compress(): too many nodes!\n");
+		return 1;
+	}
+	edgeef* ef = (edgeef*)malloc(sizeof(edgeef));
+	if(!ef) return 2;
+	if(edgeef_init(ef,e->nedges,il->N)) {
+		fprintf(stderr,"edges_compress(): nincs elég memória!\n");
+		free(ef);
+		return 2;
+	}
+	//az élek sorrendje megegyezik a kulcsok sorrendjével, mivel il->ids is rendezett
+	uint64_t i;
+	for(i=0;i<e->nedges;i++) {
+		nodeid i1 = e->dense ? e->e[i].p1 : ids_find2(il,e->e[i].p1);
+		nodeid i2 = e->dense ? e->e[i].p2 : ids_find2(il,e->e[i].p2);
+		if(edgeef_add(ef,i,i1,i2)) break;
+	}
+	if(i < e->nedges) {
+		fprintf(stderr,"edges_compress(): inconsistent node IDs (edge %lu)!\n",i);
+		edgeef_free(ef);
+		free(ef);
+		return 3;
+	}
+	edgeef_finish(ef);
+	
+	memplace_munmap(e->e,(e->edges_size)*sizeof(edge));
+	e->e = (edge*)MAP_FAILED;
+	e->edges_size = 0;
+	if(e->h) {
+		if(e->h->off) {
+			if(e->h->mapped) munmap(e->h->off,e->h->size);
+			else memplace_free(e->h->off);
 		}
-		deg++;
+		free(e->h);
+		e->h = 0;
+	}
+	if(e->hi) {
+		memplace_munmap(e->hi->slots,e->hi->width*(e->hi->mask+1));
+		free(e->hi);
+		e->hi = 0;
+	}
+	e->ef = ef;
+	e->dense = 1;
+	return 0;
+}
+
+
+//ID-k generálása N db él alapján
+idlist* ids_gen(const edge* e, uint64_t N) {
+	if(!e) return 0;
+	idlist* il = new idlist;
+	il->ids = (nodeid*)malloc(sizeof(nodeid)*(2*N + 1));
+	if(!il->ids) { delete il; return 0; }
+	uint64_t i;
+	for(i=0;i<N;i++) {
+		il->ids[2*i] = e[i].p1;
+		il->ids[2*i+1] = e[i].p2;
+	}
+	radix_sort(2*N, sizeof(nodeid), [il](size_t i, unsigned int level) {
+			return (unsigned int)((il->ids[i] >> (8*(sizeof(nodeid) - 1 - level))) & 0xffU); },
+		[il](size_t i, size_t j) { std::swap(il->ids[i], il->ids[j]); },
+		[il](size_t i, size_t j) { return il->ids[i] < il->ids[j]; });
+	uint64_t n = std::unique(il->ids, il->ids + 2*N) - il->ids;
+	if(n >= (nodeid)-1) {
+		fprintf(stderr,"ids_gen(): too many IDs (compile with -DPTG_ID64)!\n");
+		free(il->ids);
+		delete il;
+		return 0;
+	}
+	il->N = (nodeid)n;
+	nodeid* tmp = (nodeid*)realloc(il->ids, sizeof(nodeid)*(il->N + 1));
+	if(tmp) il->ids = tmp;
+	il->sent = (uint64_t*)memplace_alloc(ids_bitset_size(il->N));
+	if(!il->sent || ids_createindex(il)) {
+		ids_free(il);
+		return 0;
 	}
-	unsigned int i2 = ids_find2(il,last);
-	if(i2 < il->N) {
-		e->h->index[i2] = lastindex;
-		e->h->outdeg[i2] = deg;
+	return il;
+}
+
+//N db élben az ID-k kicserélése a sorszámukra
+int ids_replace(const idlist* il, edge* e, uint64_t N) {
+	if(!(il && e)) return 1;
+	uint64_t i;
+	//az élek többnyire p1 szerint rendezettek, így az előző keresés eredményét újra lehet használni
+	nodeid last1 = 0;
+	nodeid i1 = il->N;
+	for(i=0;i<N;i++) {
+		if(i1 == il->N || e[i].p1 != last1) {
+			last1 = e[i].p1;
+			i1 = ids_find2(il,last1);
+		}
+		nodeid i2 = ids_find2(il,e[i].p2);
+		if(i1 >= il->N || i2 >= il->N) {
+			fprintf(stderr,"ids_replace(): ID not found: %lu -> %lu!\n",(uint64_t)e[i].p1,(uint64_t)e[i].p2);
+			return 1;
+		}
+		e[i].p1 = i1;
+		e[i].p2 = i2;
 	}
 	return 0;
 }
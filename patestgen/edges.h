@@ -32,11 +32,14 @@
 #endif
 
 #include "idlist.h"
+#include "edgeef.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <ctype.h>
 #include <sys/mman.h>
+#include "memplace.h"
 //~ #include <gsl/gsl_rng.h>
 #include <limits.h>
 //~ #include "mt19937.h"
@@ -46,56 +49,201 @@
 //	a bemeneti fájlban sorbarendezve kell legyenek, minden él csak egyszer -- ezt egyszerűbb az SQL Serverrel
 //	megcsináltatni), ebben tudunk már gyorsan keresni
 
+//"helper" a gyorsabb kereséshez (CSR): minden pontra (az il-beli sorszám szerint) az első kimenő
+//	él helye a rendezett élek tömbjében, N+1 elem (az utolsó az élek száma), így az i. pont kimenő
+//	élei: [edgehelper_off(h,i), edgehelper_off(h,i+1)); az elemek 32 bitesek, vagy 40 bitesek, ha
+//	2^32-nél több él van
 typedef struct edgehelper_t {
 	const idlist* il;
-	uint64_t* index;
-	uint64_t* outdeg;
+	unsigned char* off;
+	uint64_t N; //pontok száma (il->N)
+	unsigned int width; //egy elem mérete bájtban (4 vagy 5)
+	uint64_t size; //off mérete bájtban
+	int mapped; //off egy cache fájlból van leképezve (lásd idcache.h), munmap()-pel kell felszabadítani
 } edgehelper;
 
+static inline uint64_t edgehelper_off(const edgehelper* h, uint64_t i) {
+	if(h->width == 4) return ((const uint32_t*)(h->off))[i];
+	uint64_t x;
+	memcpy(&x, h->off + 5*i, sizeof(uint64_t)); //a tömb végén van elég hely 8 bájt olvasásához
+	return x & 0xFFFFFFFFFFUL;
+}
+
+//ennél kevesebb kimenő élnél lineáris keresés, különben bináris keresés p2 szerint
+#define EDGEHELPER_SCAN 16
+
+//élek sorszámait tároló tömbök (edgestate off, edgeindex, edgequeue) elemei: 4 bájt, vagy
+//	5 bájt (40 bit), ha legalább 2^32-1 él van (a csupa 1 bit értéket az edgeindex üres
+//	helyeknek használja), így kisebb adatok esetén nem nő a memóriahasználat
+#define EDGEIDX_MAX 0xFFFFFFFFFEUL //legfeljebb ennyi él lehet
+static inline unsigned int edgeidx_width(uint64_t nedges) {
+	return (nedges >= UINT32_MAX) ? 5 : 4;
+}
+static inline uint64_t edgeidx_get(const unsigned char* p, unsigned int width) {
+	if(width == 4) {
+		uint32_t x;
+		memcpy(&x, p, 4);
+		return x;
+	}
+	uint64_t x = 0;
+	memcpy(&x, p, 5); //little endian
+	return x;
+}
+static inline void edgeidx_set(unsigned char* p, unsigned int width, uint64_t x) {
+	if(width == 4) {
+		uint32_t y = (uint32_t)x;
+		memcpy(p, &y, 4);
+	}
+	else memcpy(p, &x, 5);
+}
+//a tömbökben az üres elem (csupa 1 bit)
+static inline uint64_t edgeidx_empty(unsigned int width) {
+	return (width == 4) ? 0xFFFFFFFFUL : 0xFFFFFFFFFFUL;
+}
+
 
-//heap struktúra az élek tárolásához (összes él, idő szerint rendezve)
-typedef struct edge_t { //egy él, heap ezekből, timestamp szerint rendezve
-	uint32_t p1; //első pont -> itt az "igazi" ID-ket tároljuk (a hálózatbeli azonosítókat, ezeknek nem kell szekvenciálisnak lenni)
-	uint32_t p2; //második pont (p1->p2 él)
-	unsigned int offset; //heap-beli offset (heap[i].offset == i mindig) -- vagy: tranzakció ID-k
-	unsigned int timestamp; //legutolsó aktivitás
-} edge; //méret -- 16 bájt
+//egy él: csak a két végpont (a kulcs), a változó adatok (utolsó aktivitás, heap-beli hely)
+//	külön tömbökben vannak, lásd edgestate lent
+typedef struct edge_t {
+	nodeid p1; //első pont -> itt az "igazi" ID-ket tároljuk (a hálózatbeli azonosítókat, ezeknek nem kell szekvenciálisnak lenni)
+	nodeid p2; //második pont (p1->p2 él)
+} edge; //méret -- 8 bájt (16 bájt -DPTG_ID64 esetén)
+//a keresés csak a kulcsokat olvassa, így ezek mellé nem kerülhet más adat
+static_assert(sizeof(edge) == 2*sizeof(nodeid), "edge should only contain the keys");
+
+//egy él kulcsa (a két ID egy számban, lásd edgehash() lent): 64 bites, vagy 128 bites 64 bites ID-k esetén
+#ifdef PTG_ID64
+typedef unsigned __int128 edgekey;
+#else
+typedef uint64_t edgekey;
+#endif
+
+static inline edgekey edgekey_make(nodeid p1, nodeid p2) {
+	return (((edgekey)p1) << (8*sizeof(nodeid))) | p2;
+}
+
+//hash tábla az élek gyors kereséséhez (open addressing, lineáris próbálgatással):
+//	csak az élek tömbbeli helyét tároljuk (4 vagy 5 bájt, lásd edgeidx_width()), a kulcs
+//	(edgehash) az élek tömbjéből jön, így a tábla mérete kicsi (legfeljebb 75%-os kitöltés
+//	mellett 5.3-10.7 bájt / él)
+typedef struct edgeindex_t {
+	unsigned char* slots; //élek sorszáma, vagy üres (edgeidx_empty())
+	uint64_t mask; //tábla mérete - 1 (a méret 2 hatványa)
+	unsigned int width; //egy elem mérete bájtban
+} edgeindex;
+
+static inline uint64_t edgeindex_slot(const edgeindex* hi, uint64_t h) {
+	return edgeidx_get(hi->slots + hi->width*h, hi->width);
+}
+
+//hash fv. az edgehash értékekhez (a MurmurHash3 64 bites "finalizer"-e)
+static inline uint64_t edgeindex_hash(uint64_t x) {
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdUL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53UL;
+	x ^= x >> 33;
+	return x;
+}
+#ifdef PTG_ID64
+static inline uint64_t edgeindex_hash(edgekey x) {
+	return edgeindex_hash((uint64_t)x ^ edgeindex_hash((uint64_t)(x >> 64)));
+}
+#endif
 
 typedef struct edges_t {
 	edge* e; //élek tárolása itt, id-k szerint rendezve
+	unsigned int* ts; //időpontok, ha ezeket is beolvastuk (EFLAGS_T1), különben 0
+	unsigned int* txid; //tranzakció ID-k, ha ezeket is beolvastuk (EFLAGS_TXID), különben 0
 	uint64_t nedges;
 	uint64_t edges_size;
 	uint64_t edges_grow;
 	edgehelper* h;
+	edgeindex* hi; //ha nem 0, az élek keresése ezzel történik
+	edgeef* ef; //ha nem 0, a kulcsok tömörítve vannak tárolva (edges_compress()), e nincs meg
+	int dense; //p1 és p2 az id-k sorszámai az idlist-ben (ids_replace() után), nem az eredeti id-k
 } edges;
 
 
+/* mutable state of the edges, stored separately for each edge lifetime that is
+ * evaluated, only the parts needed for the given mode are allocated:
+ * 	ts: time of last activity (needed for finite lifetimes)
+ * 	off: position in the heap (only if an edgeheap is used), 4 or 5 bytes
+ * 		(see edgeidx_width())
+ * 	seen: one bit per edge, set if the edge was already active (infinite
+ * 		lifetime, when only this is needed instead of ts)
+ * this way, the memory used per edge is 8 bytes (keys) + 1 bit for infinite
+ * lifetime, 8 + 4 bytes with edgequeue and 8 + 8 bytes with edgeheap */
+typedef struct edgestate_t {
+	unsigned int* ts;
+	unsigned char* off;
+	uint64_t* seen;
+	uint64_t n; //élek száma
+	unsigned int off_width; //off elemeinek mérete bájtban
+} edgestate;
+
+#define EDGESTATE_TS 1
+#define EDGESTATE_OFF 2
+#define EDGESTATE_SEEN 4
+
+static inline unsigned int* edgestate_ts(const edgestate* s, uint64_t i) {
+	return s->ts + i;
+}
+static inline uint64_t edgestate_get_off(const edgestate* s, uint64_t i) {
+	return edgeidx_get(s->off + s->off_width*i, s->off_width);
+}
+static inline void edgestate_set_off(const edgestate* s, uint64_t i, uint64_t x) {
+	edgeidx_set(s->off + s->off_width*i, s->off_width, x);
+}
+//az i. él megjelölése, eredmény: 1, ha már korábban is meg volt jelölve
+static inline int edgestate_seen(edgestate* s, uint64_t i) {
+	uint64_t m = 1UL << (i & 63);
+	uint64_t x = s->seen[i >> 6];
+	s->seen[i >> 6] = x | m;
+	return (x & m) ? 1 : 0;
+}
+
+//ugyanez, több szálból is használható (ha a szálak különböző éleket jelölnek meg, de ezek
+//	bitjei ugyanabban a szóban lehetnek)
+static inline int edgestate_seen_atomic(edgestate* s, uint64_t i) {
+	uint64_t m = 1UL << (i & 63);
+	uint64_t x = __atomic_fetch_or(s->seen + (i >> 6), m, __ATOMIC_RELAXED);
+	return (x & m) ? 1 : 0;
+}
+
+//állapot létrehozása az e élekhez: a flags-ben megadott (nullázott) tömböket foglaljuk le
+//	(EDGESTATE_TS, EDGESTATE_OFF, EDGESTATE_SEEN kombinációja)
+//eredmény: 0, ha rendben volt, >0, ha nem sikerült a memóriát lefoglalni
+int edgestate_init(edgestate* s, const edges* e, int flags);
+
+//állapot felszabadítása
+void edgestate_free(edgestate* s);
+
+
 /*
  * egy tömb (unsigned int-ekből), amiben az edge-ekre mutató pointerek vannak, ezek binary heap-ben:
  * 	unsigned int* heap;
- * 	edges[heap[i]].timestamp < edges[heap[2*i+1 / 2*i+2]].timestamp
- * és edges[heap[i]].offset == i
+ * 	ts[heap[i]] < ts[heap[2*i+1 / 2*i+2]]
+ * és off[heap[i]] == i (lásd edgestate fent)
  * 
  */
 
-//hash fv. (két 32-bites id-ből egy 64-bites szám, ezeket talán gyorsabb összehasonlítani
-static inline uint64_t edgehash(const edge* e, const unsigned int i) {
-		uint64_t r = e[i].p1;
-		r = r << 32;
-		uint64_t r2 = e[i].p2;
-		return r | r2;
+//hash fv. (két 32-bites id-ből egy 64-bites szám, ezeket talán gyorsabb összehasonlítani;
+//	64 bites ID-k esetén 128 bites, lásd edgekey)
+static inline edgekey edgehash(const edge* e, uint64_t i) {
+	return edgekey_make(e[i].p1, e[i].p2);
 }
 
 //két él összehasonlítása, eredmény: -1, ha eh2-nek e[i] előtt kell lenni, 1 ha utána, 0, ha megegyeznek
-static inline int cmpedge(const edge* e, uint64_t i, uint64_t eh2) {
-	uint64_t eh1 = edgehash(e,i);
+static inline int cmpedge(const edge* e, uint64_t i, edgekey eh2) {
+	edgekey eh1 = edgehash(e,i);
 	if(eh1 < eh2) return 1;
 	if(eh1 > eh2) return -1;
 	return 0;
 }
 
 static inline int cmpedge2(const edge* e, uint64_t i, uint64_t j) {
-	uint64_t eh2 = edgehash(e,j);
+	edgekey eh2 = edgehash(e,j);
 	return cmpedge(e,i,eh2);
 }
 
@@ -111,19 +259,20 @@ edges* edges_grow(edges* e);
 void edges_free(edges* e);
 
 //élek beolvasása egy fájlból -- a fájlban már megfelelően rendezve kell lenniük
-edges* edges_read(FILE* f);
+//	a beolvasás nthreads szálon történik (0: az összes CPU-t használjuk)
+edges* edges_read(FILE* f, unsigned int nthreads = 0);
 
 //élek beolvasása egy fájlból -- a fájlban már megfelelően rendezve kell lenniük
-edges* edges_read2(FILE* f); //+ timestamp-ok is meg vannak adva
+edges* edges_read2(FILE* f, unsigned int nthreads = 0); //+ timestamp-ok is meg vannak adva
 
 //beolvasás általánosan:
 //flags értékei:
 #define EFLAGS_T1 1 //időpontokat is beolvasunk és idő szerint rendezzük az eredményt (ha nincs megadva, akkor csak
 	//éleket olvasunk be és minden élből csak egyet tartunk meg)
 #define EFLAGS_SELF 2 //megengedünk önmagába mutató éleket (p1->p1)
-#define EFLAGS_TXID 4 //tranzakció ID-ket is beolvasunk (legutolsó oszlop, az offset tömbbe tároljuk el)
+#define EFLAGS_TXID 4 //tranzakció ID-ket is beolvasunk (legutolsó oszlop, a txid tömbbe tároljuk el)
 #define EFLAGS_ERROR_OVERFLOW 8 // overflow hibát jelent (különben csak kihagyjuk)
-edges* edges_read0(FILE* f, int flags);
+edges* edges_read0(FILE* f, int flags, unsigned int nthreads = 0);
 
 //élek átmásolása egy új tömbbe, ha r == 1, akkor fordítva (p2->p1, p1->p2)
 edges* edges_copy(edges* e1, int r);
@@ -132,10 +281,46 @@ edges* edges_copy(edges* e1, int r);
 edges* edges_copy2(edges* e1, uint64_t start, uint64_t end, int r);
 
 //él megkeresése, eredmény: a tömbön (e->e) belüli sorszám, ha megtaláltuk, e->nedges, ha nem találtuk
-uint64_t edges_find(edges* e, uint32_t p1, uint32_t p2);
+uint64_t edges_find(edges* e, nodeid p1, nodeid p2);
+
+//az edges_find() által olvasott memória előzetes betöltése (prefetch), így több keresés
+//	egyszerre lehet folyamatban (lásd ptg_lookup_batch() a patest_gen.c-ben):
+//	step == 0: a hash tábla vagy a helper megfelelő eleme
+//	step == 1: az első jelölt él (ez már olvassa az előző lépésben betöltött elemet)
+static inline void edges_find_prefetch(const edges* e, nodeid p1, nodeid p2, int step) {
+	if(e->ef) edgeef_prefetch(e->ef,p1,p2,step);
+	else if(e->hi) {
+		uint64_t h = edgeindex_hash(edgekey_make(p1,p2)) & e->hi->mask;
+		if(step == 0) __builtin_prefetch(e->hi->slots + e->hi->width*h);
+		else {
+			uint64_t i = edgeindex_slot(e->hi,h);
+			if(i != edgeidx_empty(e->hi->width)) __builtin_prefetch(e->e + i);
+		}
+	}
+	else if(e->h) {
+		nodeid i1 = e->dense ? p1 : ids_find2(e->h->il,p1);
+		if(i1 >= e->h->N) return;
+		if(step == 0) __builtin_prefetch(e->h->off + e->h->width*(uint64_t)i1);
+		else __builtin_prefetch(e->e + edgehelper_off(e->h,i1));
+	}
+}
+
+//az i. él végpontjainak sorszáma az il-ben (i1 lehet 0, ha nincs rá szükség); il-ben nem
+//	szereplő ID esetén il->N
+static inline void edges_nodes(const edges* e, const idlist* il, uint64_t i, nodeid* i1, nodeid* i2) {
+	if(e->ef) edgeef_get(e->ef,i,i1,i2);
+	else if(e->dense) {
+		if(i1) *i1 = e->e[i].p1;
+		*i2 = e->e[i].p2;
+	}
+	else {
+		if(i1) *i1 = ids_find2(il,e->e[i].p1);
+		*i2 = ids_find2(il,e->e[i].p2);
+	}
+}
 
 //olyan él keresése, ahol az első ID megegyezik a megadottal
-uint64_t edges_findfirst(edges* e, uint32_t p1);
+uint64_t edges_findfirst(edges* e, nodeid p1);
 
 //élek sorbarendezése az ID-k szerint
 void edges_sort1(edges* e);
@@ -152,15 +337,30 @@ void edges_rand1(edges* e, uint64_t N, gsl_rng* r);
 void edges_rand2(edges* e, uint64_t N, gsl_rng* r);
 */
 
-// create a "helper" for faster edge lookups: store the starting index for each addr, making it unnecessary to perform binary
-//	search for the whole set, and also return result in O(1) time for addresses with outdeg == 1
+// create a "helper" for faster edge lookups: store the starting index for each addr (in CSR format, see above), making it
+//	unnecessary to perform binary search for the whole set; edges_find() then searches only among the edges of p1
 int edges_createhelper(edges* e, const idlist* il);
 
+// create a hash index for edge lookups (see edgeindex above); if it exists, edges_find() uses it
+//	(this should be created after the edges are finalized, e.g. after ids_replace())
+//	returns 0 on success
+int edges_createindex(edges* e);
+
+// replace the array of edges by a compressed, read-only index (see edgeef.h); indices of the
+//	edges stay the same, e->dense is set, since lookups use node indices from then on; the
+//	helper and the hash index are freed as well, as edges_find() uses only the new index;
+//	this requires that all IDs are in il, less than 2^32 nodes and no e->ts or e->txid
+//	returns 0 on success, in case of an error, e is not changed
+int edges_compress(edges* e, const idlist* il);
+
 
-//ID-k generálása N db él alapján
-idlist* ids_gen(const edge* e, unsigned int N);
+//ID-k generálása N db él alapján (az összes előforduló ID, rendezve)
+idlist* ids_gen(const edge* e, uint64_t N);
 
-//N db élben az ID-k kicserélése a sorszámukra
+//N db élben az ID-k kicserélése a sorszámukra (0 .. il->N-1), így a további keresések
+//	elkerülhetők; az eredeti ID-k il->ids-ben maradnak
+//eredmény: 0, ha rendben volt, 1, ha valamelyik ID nem szerepel il-ben
+//(a sorrend nem változik, mivel il->ids rendezett, tehát ha e rendezve volt, az is marad)
 int ids_replace(const idlist* il, edge* e, uint64_t N);
 
 
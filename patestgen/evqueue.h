@@ -0,0 +1,150 @@
+/*  -*- C++ -*-
+ * evqueue.h -- in-memory queue passing events from the generator (ptg)
+ * 	to a consumer running in a separate thread (e.g. rank calculation,
+ * 	see ranks.h); events are passed in blocks, the number of blocks in
+ * 	the queue is limited, so the producer waits if the consumer is slower
+ *
+ * Copyright 2020 Daniel Kondor <kondor.dani@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of the  nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef EVQUEUE_H
+#define EVQUEUE_H
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/* one event, as output by ptg */
+struct evqueue_event {
+	uint32_t deg;
+	uint32_t ts;
+	uint32_t deg2; /* new degree, only for type 6 */
+	uint8_t type;
+	uint8_t contract;
+};
+
+/* single producer, single consumer queue of blocks of events */
+class evqueue {
+	public:
+		/* block_size: number of events in one block
+		 * max_blocks: maximum number of blocks allocated (in the queue + being filled / processed) */
+		explicit evqueue(size_t block_size_ = 65536, size_t max_blocks_ = 8):
+			block_size(block_size_), max_blocks(max_blocks_ < 3 ? 3 : max_blocks_) { }
+		~evqueue() {
+			for(evqueue_event* b : all) delete[] b;
+		}
+		evqueue(const evqueue&) = delete;
+		evqueue& operator = (const evqueue&) = delete;
+
+		/* add one event (producer side) -- note: this might block if the consumer is slow */
+		void push(unsigned int type, unsigned int deg, unsigned int ts, int contract, unsigned int deg2 = 0) {
+			if(cur_n == block_size || !cur) submit();
+			evqueue_event& e = cur[cur_n++];
+			e.deg = deg;
+			e.ts = ts;
+			e.deg2 = deg2;
+			e.type = type;
+			e.contract = contract;
+		}
+
+		/* signal that there will be no more events (producer side) */
+		void close() {
+			std::unique_lock<std::mutex> lock(m);
+			if(cur) {
+				if(cur_n) full.push_back(std::make_pair(cur,cur_n));
+				else free_blocks.push_back(cur);
+				cur = 0;
+				cur_n = 0;
+			}
+			done = true;
+			cv_full.notify_all();
+		}
+
+		/* get the next block of events to process (consumer side); the
+		 * previous block returned is recycled; returns the number of events
+		 * in the block, 0 if there are no more events */
+		size_t pop(const evqueue_event** block) {
+			std::unique_lock<std::mutex> lock(m);
+			if(out_block) {
+				free_blocks.push_back(out_block);
+				out_block = 0;
+				cv_free.notify_one();
+			}
+			while(full.empty() && !done) cv_full.wait(lock);
+			if(full.empty()) return 0;
+			out_block = full.front().first;
+			size_t n = full.front().second;
+			full.pop_front();
+			*block = out_block;
+			return n;
+		}
+
+	protected:
+		/* pass the current block to the consumer, get a new (empty) block */
+		void submit() {
+			std::unique_lock<std::mutex> lock(m);
+			if(cur) {
+				full.push_back(std::make_pair(cur,cur_n));
+				cur = 0;
+				cur_n = 0;
+				cv_full.notify_one();
+			}
+			while(free_blocks.empty() && all.size() >= max_blocks) cv_free.wait(lock);
+			if(free_blocks.size()) {
+				cur = free_blocks.back();
+				free_blocks.pop_back();
+			}
+			else {
+				cur = new evqueue_event[block_size];
+				all.push_back(cur);
+			}
+		}
+
+		const size_t block_size;
+		const size_t max_blocks;
+
+		evqueue_event* cur = 0; /* block being filled by the producer */
+		size_t cur_n = 0;
+		evqueue_event* out_block = 0; /* block being processed by the consumer */
+
+		std::mutex m;
+		std::condition_variable cv_full; /* signals that a new block is available to the consumer */
+		std::condition_variable cv_free; /* signals that a block was recycled by the consumer */
+		std::deque<std::pair<evqueue_event*,size_t> > full; /* blocks waiting to be processed */
+		std::vector<evqueue_event*> free_blocks;
+		std::vector<evqueue_event*> all; /* all blocks allocated */
+		bool done = false;
+};
+
+#endif
+
@@ -0,0 +1,218 @@
+/*
+ * idcache.cpp -- beolvasott azonosítók és élek tárolása egy bináris fájlban
+ *
+ * Copyright 2020 Kondor Dániel <kondor.dani@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "idcache.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <vector>
+#include <string>
+
+
+/* hash of a file's contents: four independent lanes of 64-bit words (so
+ * that the multiplications can overlap), combined at the end */
+static int idcache_hash_file(const char* fn, uint64_t* size, uint64_t* hash) {
+	FILE* f = fopen(fn,"rb");
+	if(!f) return 1;
+	const size_t bufsize = 1048576;
+	std::vector<uint64_t> buf(bufsize/sizeof(uint64_t));
+	uint64_t h[4] = {1, 2, 3, 4};
+	uint64_t total = 0;
+	int ret = 0;
+	while(true) {
+		size_t r = fread(buf.data(),1,bufsize,f);
+		if(r < bufsize) {
+			if(ferror(f)) { ret = 1; break; }
+			/* the last partial word is padded with zeros */
+			memset(((char*)buf.data()) + r, 0, bufsize - r);
+		}
+		total += r;
+		size_t n = (r + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+		for(size_t i=0;i<n;i++) h[i&3] = edgeindex_hash(h[i&3] ^ buf[i]) + i;
+		if(r < bufsize) break;
+	}
+	fclose(f);
+	if(ret) return ret;
+	*size = total;
+	*hash = edgeindex_hash(h[0] ^ edgeindex_hash(h[1] ^ edgeindex_hash(h[2] ^ edgeindex_hash(h[3] ^ total))));
+	return 0;
+}
+
+int idcache_checksum(idcache_src* src, const char* fids, const char* flinks) {
+	memset(src,0,sizeof(idcache_src));
+	if(idcache_hash_file(fids,src->size,src->hash)) return 1;
+	if(idcache_hash_file(flinks,src->size+1,src->hash+1)) return 1;
+	return 0;
+}
+
+
+static void* idcache_map(int fd, uint64_t off, uint64_t size) {
+	/* private writable mapping: the file is never modified, but the arrays
+	 * can be used the same way as the ones allocated by ids_read() / edges_read() */
+	return mmap(0,size,PROT_READ | PROT_WRITE,MAP_PRIVATE,fd,off);
+}
+
+int idcache_load(const char* fn, const idcache_src* src, int flags, idlist** il, edges** e) {
+	int fd = open(fn,O_RDONLY);
+	if(fd < 0) return 1;
+
+	idcache_header hdr;
+	struct stat st;
+	uint64_t pagesize = sysconf(_SC_PAGESIZE);
+	uint64_t ids_size;
+	int ret = 1;
+	idlist* il1 = 0;
+	edges* e1 = 0;
+
+	if(pread(fd,&hdr,sizeof(hdr),0) != (ssize_t)sizeof(hdr)) goto idcache_load_end;
+	if(hdr.magic != IDCACHE_MAGIC || hdr.version != IDCACHE_VERSION) {
+		fprintf(stderr,"idcache_load(): %s is not a valid cache file, or it was created by an incompatible version!\n",fn);
+		goto idcache_load_end;
+	}
+	if(sizeof(nodeid) == 8) flags |= IDCACHE_ID64;
+	if(hdr.flags != (uint32_t)flags || memcmp(&hdr.src,src,sizeof(idcache_src))) goto idcache_load_end;
+	if(fstat(fd,&st) || (uint64_t)st.st_size != hdr.size) goto idcache_load_end;
+	if(!hdr.N || hdr.N >= (nodeid)-1 || !hdr.nedges) goto idcache_load_end;
+	if(hdr.off_ids % pagesize || hdr.off_contract % pagesize || hdr.off_edges % pagesize || hdr.off_helper % pagesize)
+		goto idcache_load_end;
+	ids_size = hdr.N*sizeof(nodeid);
+	if(hdr.off_ids + ids_size > hdr.size || hdr.off_edges + hdr.nedges*sizeof(edge) > hdr.size) goto idcache_load_end;
+	if((flags & IDCACHE_CONTRACTS) && hdr.off_contract + ids_bitset_size(hdr.N) > hdr.size) goto idcache_load_end;
+	if(flags & IDCACHE_HELPER) {
+		if(!(hdr.helper_width == 4 || hdr.helper_width == 5)) goto idcache_load_end;
+		if(hdr.helper_size < hdr.helper_width*(hdr.N+1) + sizeof(uint64_t)) goto idcache_load_end;
+		if(hdr.off_helper + hdr.helper_size > hdr.size) goto idcache_load_end;
+	}
+
+	/* the cache can be used, any error from here is a real error */
+	ret = 2;
+	il1 = new idlist;
+	il1->N = (nodeid)hdr.N;
+	il1->mapped = true;
+	il1->ids = (nodeid*)idcache_map(fd,hdr.off_ids,ids_size);
+	if(il1->ids == MAP_FAILED) { il1->ids = nullptr; goto idcache_load_end; }
+	if(flags & IDCACHE_CONTRACTS) {
+		il1->contract = (uint64_t*)idcache_map(fd,hdr.off_contract,ids_bitset_size(hdr.N));
+		if(il1->contract == MAP_FAILED) { il1->contract = nullptr; goto idcache_load_end; }
+	}
+	il1->sent = (uint64_t*)memplace_alloc(ids_bitset_size(hdr.N));
+	if(!il1->sent) goto idcache_load_end;
+	if(ids_createindex(il1)) goto idcache_load_end; /* not stored in the cache, it is fast to create */
+
+	e1 = (edges*)malloc(sizeof(edges));
+	if(!e1) goto idcache_load_end;
+	e1->e = (edge*)idcache_map(fd,hdr.off_edges,hdr.nedges*sizeof(edge));
+	e1->ts = 0;
+	e1->txid = 0;
+	e1->nedges = hdr.nedges;
+	e1->edges_size = (e1->e == MAP_FAILED) ? 0 : hdr.nedges;
+	e1->edges_grow = hdr.nedges;
+	e1->h = 0;
+	e1->hi = 0;
+	e1->ef = 0;
+	e1->dense = (flags & IDCACHE_DENSE) ? 1 : 0;
+	if(e1->e == MAP_FAILED) goto idcache_load_end;
+	if(flags & IDCACHE_HELPER) {
+		e1->h = (edgehelper*)malloc(sizeof(edgehelper));
+		if(!e1->h) goto idcache_load_end;
+		e1->h->il = il1;
+		e1->h->N = hdr.N;
+		e1->h->width = (unsigned int)hdr.helper_width;
+		e1->h->size = hdr.helper_size;
+		e1->h->off = (unsigned char*)idcache_map(fd,hdr.off_helper,hdr.helper_size);
+		if(e1->h->off == MAP_FAILED) { e1->h->off = 0; goto idcache_load_end; }
+		e1->h->mapped = 1;
+	}
+	ret = 0;
+
+idcache_load_end:
+	if(ret == 2) fprintf(stderr,"idcache_load(): error mapping the contents of %s!\n",fn);
+	if(ret) {
+		if(il1) ids_free(il1);
+		if(e1) edges_free(e1);
+	}
+	else {
+		*il = il1;
+		*e = e1;
+	}
+	close(fd);
+	return ret;
+}
+
+
+/* write len bytes from buf, followed by zeros up to the next multiple of IDCACHE_ALIGN;
+ * pos is updated with the position after the padding */
+static int idcache_write_array(FILE* f, const void* buf, uint64_t len, uint64_t* pos) {
+	static const char zeros[IDCACHE_ALIGN] = {0};
+	if(len && fwrite(buf,1,len,f) != len) return 1;
+	uint64_t pad = (IDCACHE_ALIGN - len % IDCACHE_ALIGN) % IDCACHE_ALIGN;
+	if(pad && fwrite(zeros,1,pad,f) != pad) return 1;
+	*pos += len + pad;
+	return 0;
+}
+
+int idcache_write(const char* fn, const idcache_src* src, const idlist* il, const edges* e) {
+	if(!(il && il->N && il->ids && e && e->nedges && e->e != MAP_FAILED)) return 1;
+
+	idcache_header hdr;
+	memset(&hdr,0,sizeof(hdr));
+	hdr.magic = IDCACHE_MAGIC;
+	hdr.version = IDCACHE_VERSION;
+	hdr.flags = (e->dense ? IDCACHE_DENSE : 0) | (il->contract ? IDCACHE_CONTRACTS : 0) |
+		((e->h && e->h->off) ? IDCACHE_HELPER : 0) | ((sizeof(nodeid) == 8) ? IDCACHE_ID64 : 0);
+	hdr.src = *src;
+	hdr.N = il->N;
+	hdr.nedges = e->nedges;
+	if(e->h && e->h->off) {
+		hdr.helper_width = e->h->width;
+		hdr.helper_size = e->h->size;
+	}
+	/* positions of the arrays */
+	uint64_t pos = IDCACHE_ALIGN;
+	auto next = [&pos](uint64_t len) { uint64_t x = pos; pos += ((len + IDCACHE_ALIGN - 1) / IDCACHE_ALIGN) * IDCACHE_ALIGN; return x; };
+	hdr.off_ids = next(hdr.N*sizeof(nodeid));
+	if(il->contract) hdr.off_contract = next(ids_bitset_size(hdr.N));
+	hdr.off_edges = next(hdr.nedges*sizeof(edge));
+	if(hdr.helper_size) hdr.off_helper = next(hdr.helper_size);
+	hdr.size = pos;
+
+	std::string tmp = std::string(fn) + ".tmp";
+	FILE* f = fopen(tmp.c_str(),"wb");
+	if(!f) {
+		fprintf(stderr,"idcache_write(): error opening file %s!\n",tmp.c_str());
+		return 1;
+	}
+	pos = 0;
+	int ret = idcache_write_array(f,&hdr,sizeof(hdr),&pos);
+	if(!ret) ret = idcache_write_array(f,il->ids,hdr.N*sizeof(nodeid),&pos);
+	if(!ret && il->contract) ret = idcache_write_array(f,il->contract,ids_bitset_size(hdr.N),&pos);
+	if(!ret) ret = idcache_write_array(f,e->e,hdr.nedges*sizeof(edge),&pos);
+	if(!ret && hdr.helper_size) ret = idcache_write_array(f,e->h->off,hdr.helper_size,&pos);
+	if(!ret && pos != hdr.size) ret = 1;
+	if(fclose(f)) ret = 1;
+	if(!ret && rename(tmp.c_str(),fn)) ret = 1;
+	if(ret) {
+		fprintf(stderr,"idcache_write(): error writing file %s!\n",fn);
+		unlink(tmp.c_str());
+	}
+	return ret;
+}
+
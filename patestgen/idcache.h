@@ -0,0 +1,95 @@
+/*
+ * idcache.h -- beolvasott azonosítók és élek tárolása egy bináris fájlban
+ *
+ * reading, sorting and processing the lists of IDs and edges (ids_read(),
+ * edges_read(), ids_replace(), edges_createhelper()) gives the same result
+ * for the same input files; the result can be saved in a cache file, which
+ * can be mapped (mmap()) directly in later runs instead of processing the
+ * input again
+ *
+ * file format (native byte order): a header (idcache_header below),
+ * followed by the arrays, each starting on a page boundary:
+ * 	il->ids (N * 4 bytes)
+ * 	il->contract (bitset of ids_bitset_size(N) bytes, if IDCACHE_CONTRACTS is set)
+ * 	e->e (nedges * 8 bytes)
+ * 	e->h->off (helper_size bytes, if IDCACHE_HELPER is set)
+ *
+ * the cache is only used if its version and flags match the ones requested
+ * and the checksums of the input files are the same as the ones stored in it
+ * (the checksum is calculated from the contents of the files as they are,
+ * i.e. compressed files are not decompressed for this)
+ *
+ * Copyright 2020 Kondor Dániel <kondor.dani@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+
+#ifndef IDCACHE_H
+#define IDCACHE_H
+#include "edges.h"
+
+#define IDCACHE_MAGIC 0x4548434143475450UL //"PTGCACHE"
+#define IDCACHE_VERSION 2
+#define IDCACHE_ALIGN 4096UL //a tömbök kezdete a fájlban (a lapméret többszöröse kell legyen)
+
+//flags értékei
+#define IDCACHE_DENSE 1 //az élekben az ID-k sorszámai vannak (ids_replace())
+#define IDCACHE_CONTRACTS 2 //il->contract is el van tárolva
+#define IDCACHE_HELPER 4 //a helper (edges_createhelper()) is el van tárolva
+#define IDCACHE_ID64 8 //64 bites ID-k (-DPTG_ID64), ezt az idcache függvények állítják be
+
+//bemeneti fájlok ellenőrzőösszege
+struct idcache_src {
+	uint64_t size[2]; //ID-k és élek fájljának mérete
+	uint64_t hash[2]; //tartalmukból számolt hash
+};
+
+struct idcache_header {
+	uint64_t magic;
+	uint32_t version;
+	uint32_t flags;
+	idcache_src src;
+	uint64_t N; //ID-k száma
+	uint64_t nedges;
+	uint64_t helper_width; //a helper elemeinek mérete (4 vagy 5)
+	uint64_t helper_size; //a helper tömbjének mérete bájtban
+	uint64_t off_ids; //tömbök kezdete a fájlban
+	uint64_t off_contract;
+	uint64_t off_edges;
+	uint64_t off_helper;
+	uint64_t size; //a teljes fájl mérete
+};
+
+//a bemeneti fájlok ellenőrzőösszegének kiszámítása
+//eredmény: 0, ha rendben volt, 1, ha valamelyik fájlt nem sikerült beolvasni
+int idcache_checksum(idcache_src* src, const char* fids, const char* flinks);
+
+//cache betöltése: ha a fájl létezik, és a megadott flags-szel, ugyanazokból a bemeneti fájlokból
+//	készült, akkor az ID-k és élek tömbjeit mmap()-pel képezzük le (az élek és az ID-k
+//	felszabadításakor ezeket munmap()-pel szabadítjuk fel, ids_free() és edges_free() ezt kezeli)
+//eredmény: 0, ha sikerült, ekkor *il és *e az új struktúrák; 1, ha a cache nem létezik, vagy nem
+//	használható (ilyenkor *il és *e nem változik); >1 egyéb hiba esetén
+int idcache_load(const char* fn, const idcache_src* src, int flags, idlist** il, edges** e);
+
+//cache kiírása a már feldolgozott ID-k és élek alapján (a flags-ben megadott részek, a helpert
+//	akkor írjuk ki, ha e->h létezik); először egy ideiglenes fájlba írunk, és csak a végén
+//	nevezzük át, így egy félbeszakadt írás nem hagy hibás cache-t
+//eredmény: 0, ha rendben volt
+int idcache_write(const char* fn, const idcache_src* src, const idlist* il, const edges* e);
+
+#endif
+
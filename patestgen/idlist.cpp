@@ -23,14 +23,23 @@
 
 #include "idlist.h"
 #include "edges.h"
-#include "iterator_zip.h"
+#include "radix_sort.h"
+#include "chunkread.h"
+#include <vector>
 
 void ids_free(idlist* id) {
 	if(id) {
-		if(id->ids) free(id->ids);
-		if(id->inlinks) free(id->inlinks);
-		if(id->outtx) free(id->outtx);
-		if(id->contract) free(id->contract);
+		if(id->mapped) {
+			if(id->ids) munmap(id->ids, sizeof(nodeid)*id->N);
+			if(id->contract) munmap(id->contract, ids_bitset_size(id->N));
+		}
+		else {
+			if(id->ids) memplace_free(id->ids);
+			if(id->contract) memplace_free(id->contract);
+		}
+		if(id->contract_in) memplace_free(id->contract_in);
+		if(id->sent) memplace_free(id->sent);
+		if(id->idx) memplace_free(id->idx);
 		delete id;
 	}
 }
@@ -40,21 +49,95 @@ static bool ids_grow(idlist* l, size_t& current_size, size_t new_size, bool have
 	const size_t grow_size = 4194304UL; // allocate space in 4M chunks -- 52M memory
 	if(!l) return false;
 	if(!new_size || new_size <= current_size) new_size = current_size + grow_size;
-	unsigned int* tmp = (unsigned int*)realloc(l->ids, sizeof(unsigned int)*new_size);
+	nodeid* tmp = (nodeid*)memplace_realloc(l->ids, sizeof(nodeid)*current_size, sizeof(nodeid)*new_size);
 	if(!tmp) return false;
 	l->ids = tmp;
 	if(have_contracts) {
-		char* contract = (char*)realloc(l->contract, sizeof(char)*new_size);
+		char* contract = (char*)memplace_realloc(l->contract_in, sizeof(char)*current_size, sizeof(char)*new_size);
 		if(!contract) return false;
-		l->contract = contract;
+		l->contract_in = contract;
 	}
 	current_size = new_size;
 	return true;
 }
 
 
+//beolvasás után: sorbarendezés és a további tömbök lefoglalása
+static idlist* ids_finish(idlist* ret, size_t i) {
+	if(i >= (nodeid)-1) {
+		fprintf(stderr,"ids_read(): too many IDs (compile with -DPTG_ID64)!\n");
+		ids_free(ret);
+		return nullptr;
+	}
+	ret->N = i;
+	
+	/* sort the IDs (together with the contract flags, if given) */
+	nodeid* ids = ret->ids;
+	char* contract = ret->contract_in;
+	radix_sort(i, sizeof(nodeid), [ids](size_t j, unsigned int level) {
+			return (unsigned int)((ids[j] >> (8*(sizeof(nodeid) - 1 - level))) & 0xffU); },
+		[ids,contract](size_t j, size_t k) {
+			std::swap(ids[j], ids[k]);
+			if(contract) std::swap(contract[j], contract[k]);
+		},
+		[ids](size_t j, size_t k) { return ids[j] < ids[k]; });
+	
+	/* pack the contract flags into a bitset */
+	if(contract) {
+		ret->contract = (uint64_t*)memplace_alloc(ids_bitset_size(i));
+		if(!ret->contract) {
+			ids_free(ret);
+			return nullptr;
+		}
+		for(size_t j=0;j<i;j++) if(contract[j]) ret->contract[j >> 6] |= (1UL << (j & 63));
+		memplace_free(contract);
+		ret->contract_in = nullptr;
+	}
+	
+	ret->sent = (uint64_t*)memplace_alloc(ids_bitset_size(i));
+	if(!ret->sent || ids_createindex(ret)) {
+		ids_free(ret);
+		return nullptr;
+	}
+	
+	return ret;
+}
+
+
+int ids_createindex(idlist* l) {
+	if(l->idx) memplace_free(l->idx);
+	l->idx = nullptr;
+	l->idx_shift = 0;
+	l->idx_size = 0;
+	/* dense IDs are found directly by ids_find2() */
+	if(!l->N || l->ids[l->N - 1] <= l->N) return 0;
+	
+	/* number of ranges: at most N/4, i.e. at least 4 IDs / range on average,
+	 * the index uses at most 1 byte / ID (2 bytes with -DPTG_ID64) */
+	uint64_t max_ranges = l->N/4 + 1;
+	unsigned int shift = 0;
+	while(((uint64_t)(l->ids[l->N - 1]) >> shift) >= max_ranges) shift++;
+	nodeid size = (l->ids[l->N - 1] >> shift) + 1;
+	nodeid* idx = (nodeid*)memplace_alloc(sizeof(nodeid)*((uint64_t)size + 1));
+	if(!idx) {
+		fprintf(stderr,"ids_createindex(): nincs elég memória!\n");
+		return 1;
+	}
+	nodeid j = 0;
+	for(nodeid b = 0; b < size; b++) {
+		idx[b] = j;
+		while(j < l->N && (l->ids[j] >> shift) == b) j++;
+	}
+	idx[size] = l->N;
+	l->idx = idx;
+	l->idx_shift = shift;
+	l->idx_size = size;
+	return 0;
+}
+
+
 //id-k beolvasása a megadott fájlból (maximum N darab)
-idlist* ids_read(read_table2& rt, unsigned int N, bool have_contracts) {
+idlist* ids_read(read_table2& rt, uint64_t N, bool have_contracts) {
 	idlist* ret = new idlist;
 	if(!ret) return nullptr;
 
@@ -74,7 +157,7 @@ idlist* ids_read(read_table2& rt, unsigned int N, bool have_contracts) {
 		if(have_contracts) {
 			int tmp;
 			if(!rt.read(read_table_skip(), tmp)) break;
-			ret->contract[i] = !!tmp;
+			ret->contract_in[i] = !!tmp;
 		}
 	}
 	if(rt.get_last_error() != T_EOF) {
@@ -83,21 +166,69 @@ idlist* ids_read(read_table2& rt, unsigned int N, bool have_contracts) {
 		return nullptr;
 	}
 	
-	ret->N = i;
-	
-	if(have_contracts) std::sort(zi::make_zip_it(ret->ids, ret->contract),
-		zi::make_zip_it(ret->ids + i, ret->contract + i),
-		[](const auto& x, const auto& y) { return x.first < y.first; });
-	else std::sort(ret->ids, ret->ids + i);
+	return ids_finish(ret, i);
+}
+
+
+/* a fájl részenként, párhuzamosan van feldolgozva (lásd chunkread.h) */
+struct ids_chunk {
+	std::vector<nodeid> ids;
+	std::vector<char> contract;
+};
+
+static int ids_read_chunk(const char* buf, size_t len, uint64_t line0, bool have_contracts, ids_chunk& c) {
+	FILE* f = fmemopen((void*)buf, len, "r");
+	if(!f) return 1;
+	read_table2 rt(f);
+	rt.line = line0; /* line numbers in error messages refer to the whole file */
+	while(rt.read_line()) {
+		nodeid id;
+		if(!rt.read(id)) break;
+		c.ids.push_back(id);
+		if(have_contracts) {
+			int tmp;
+			if(!rt.read(read_table_skip(), tmp)) break;
+			c.contract.push_back(!!tmp);
+		}
+	}
+	int ret = 0;
+	if(rt.get_last_error() != T_EOF) {
+		rt.write_error(stderr);
+		ret = 1;
+	}
+	fclose(f);
+	return ret;
+}
+
+idlist* ids_read(FILE* f, uint64_t N, bool have_contracts, unsigned int nthreads) {
+	if(!f) return nullptr;
+	idlist* ret = new idlist;
+	if(!ret) return nullptr;
+
+	size_t current_size = 0;
+	if(!ids_grow(ret, current_size, N, have_contracts)) {
+		delete ret;
+		return nullptr;
+	}
 	
-	ret->inlinks = (unsigned int*)calloc(i, sizeof(unsigned int));
-	ret->outtx = (unsigned int*)calloc(i, sizeof(unsigned int));
-	if(!(ret->inlinks && ret->outtx)) {
+	size_t i = 0;
+	int r = chunkread<ids_chunk>(f,
+		[have_contracts](const char* buf, size_t len, uint64_t line0, ids_chunk& c) {
+			return ids_read_chunk(buf, len, line0, have_contracts, c);
+		},
+		[ret,&i,&current_size,have_contracts](ids_chunk& c) {
+			size_t n = c.ids.size();
+			if(i + n > current_size && !ids_grow(ret, current_size, i + n, have_contracts)) return 1;
+			std::copy(c.ids.begin(), c.ids.end(), ret->ids + i);
+			if(have_contracts) std::copy(c.contract.begin(), c.contract.end(), ret->contract_in + i);
+			i += n;
+			return 0;
+		}, nthreads);
+	if(r) {
+		if(r < 0) fprintf(stderr, "ids_read(): error reading the input!\n");
 		ids_free(ret);
 		return nullptr;
 	}
 	
-	return ret;
+	return ids_finish(ret, i);
 }
-
-
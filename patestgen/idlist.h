@@ -27,44 +27,92 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <algorithm>
 
 #include "read_table.h"
 
+/* node IDs, and also the positions of the IDs in the idlist (and so the number of
+ * nodes): 32-bit by default; compile with -DPTG_ID64 for 64-bit IDs -- this doubles
+ * the memory used by the edges and the IDs, so it is only needed if the IDs (or the
+ * number of nodes) do not fit in 32 bits */
+#ifdef PTG_ID64
+typedef uint64_t nodeid;
+#else
+typedef uint32_t nodeid;
+#endif
+
 struct idlist {
-	unsigned int N = 0; //id-k száma
-	unsigned int* ids = nullptr; //id-k tárolása
-	unsigned int* inlinks = nullptr; //bejövő linkek száma
-	unsigned int* outtx = nullptr; //kimenő tranzakciók száma (txin-beli tranzakciók szerint)
-	char* contract = nullptr; //flag to store which address is a contract (only for Ethereum)
+	nodeid N = 0; //id-k száma
+	nodeid* ids = nullptr; //id-k tárolása
+	/* per-node flags are stored as bitsets (ids_bitset_size() bytes, bit i of
+	 * word i/64 belongs to ids[i]), use the accessors below; the in-degrees
+	 * depend on the lifetime, see nodedeg.h */
+	uint64_t* sent = nullptr; //küldött-e már tranzakciót (ami aktiválta valamelyik élettartamban)
+	uint64_t* contract = nullptr; //flag to store which address is a contract (only for Ethereum)
+	char* contract_in = nullptr; //contract flags as read, only used while reading (see ids_read())
+	bool mapped = false; //ids és contract egy cache fájlból van leképezve (lásd idcache.h)
+	/* index for ids_find() if the IDs are not dense (see ids_createindex()): the
+	 * IDs with the same high bits (id >> idx_shift == b) are in ids[idx[b]] ..
+	 * ids[idx[b+1]-1], so only this short range needs to be searched */
+	nodeid* idx = nullptr;
+	unsigned int idx_shift = 0;
+	nodeid idx_size = 0; //number of ranges (idx has idx_size + 1 elements)
 };
 
+//bitset mérete (bájtban) N darab id-hez
+static inline size_t ids_bitset_size(uint64_t N) { return (N/64 + 1)*sizeof(uint64_t); }
+
+//i. id szerződés-e (csak ha l->contract nem nullptr)
+static inline bool ids_contract(const idlist* l, nodeid i) { return (l->contract[i >> 6] >> (i & 63)) & 1; }
+//i. id küldött-e már tranzakciót
+static inline bool ids_sent(const idlist* l, nodeid i) { return (l->sent[i >> 6] >> (i & 63)) & 1; }
+static inline void ids_set_sent(idlist* l, nodeid i) { l->sent[i >> 6] |= (1UL << (i & 63)); }
+
 //id-k felszabadítása
 void ids_free(idlist* id);
 
 //id-k beolvasása a megadott fájlból (N egy tipp a méretre)
-idlist* ids_read(read_table2& rt, unsigned int N = 0, bool have_contracts = false);
-static inline idlist* ids_read(read_table2&& rt, unsigned int N = 0, bool have_contracts = false) {
+idlist* ids_read(read_table2& rt, uint64_t N = 0, bool have_contracts = false);
+static inline idlist* ids_read(read_table2&& rt, uint64_t N = 0, bool have_contracts = false) {
 	return ids_read(rt, N, have_contracts);
 }
-static inline idlist* ids_read(FILE* f, unsigned int N = 0, bool have_contracts = false) {
-	return f ? ids_read(read_table2(f), N, have_contracts) : nullptr;
-}
+//ugyanez egy fájlból, nthreads szálon (0: az összes CPU-t használjuk, lásd chunkread.h)
+idlist* ids_read(FILE* f, uint64_t N = 0, bool have_contracts = false, unsigned int nthreads = 0);
+
+//index létrehozása az id-k gyors kereséséhez (lásd idx fent), ha nem sűrűek az id-k;
+//	az id-k beolvasása után automatikusan megtörténik; eredmény: 0, ha rendben volt
+int ids_createindex(idlist* l);
 
 //id megkeresése: eredmény a tömbbeli hely, vagy l->N, ha nem találtuk
-static inline unsigned int ids_find(const idlist* l, unsigned int id) {
+static inline nodeid ids_find(const idlist* l, nodeid id) {
 	if(!l) return 0;
-	unsigned int* res = std::lower_bound(l->ids, l->ids + l->N, id);
-	unsigned int ret = (unsigned int)(res - l->ids);
+	const nodeid* start = l->ids;
+	const nodeid* end = l->ids + l->N;
+	if(l->idx) {
+		nodeid b = id >> l->idx_shift;
+		if(b >= l->idx_size) return l->N;
+		start = l->ids + l->idx[b];
+		end = l->ids + l->idx[b+1];
+	}
+	const nodeid* res = std::lower_bound(start, end, id);
+	nodeid ret = (nodeid)(res - l->ids);
 	if(ret < l->N && *res != id) ret = l->N;
 	return ret;
 }
 
-static inline unsigned int ids_find2(const idlist* l, unsigned int id) {
+static inline nodeid ids_find2(const idlist* l, nodeid id) {
 	if(id && id <= l->N && l->ids[id-1] == id) return id-1;
 	else if(id < l->N && l->ids[id] == id) return id;
 	return ids_find(l,id);
 }
 
+//az ids_find2() által először olvasott elemek előzetes betöltése (prefetch), így több
+//	keresés memória-hozzáférései átfedhetnek (lásd ptg_lookup_batch() a patest_gen.c-ben)
+static inline void ids_prefetch(const idlist* l, nodeid id) {
+	if(id && id <= l->N) __builtin_prefetch(l->ids + id - 1);
+	if(l->idx && (id >> l->idx_shift) < l->idx_size) __builtin_prefetch(l->idx + (id >> l->idx_shift));
+}
+
 #endif
 
@@ -20,6 +20,13 @@
  * std::pair<int,double> val = *itbg;
  * *itbg = std::make_pair(1,2.0);
  * 
+ * any number of iterators can be combined with make_zip_itn(), the elements
+ * are then std::tuple-like (access with std::get<i>()):
+ * std::vector<char> v3;
+ * auto it3 = make_zip_itn(v1.begin(),v2.begin(),v3.begin());
+ * std::get<2>(*it3) == *(v3.begin());
+ * std::tuple<int,double,char> val3 = *it3;
+ * 
  * Copyright 2018 Daniel Kondor <kondor.dani@gmail.com>
  * 
  * Redistribution and use in source and binary forms, with or without
@@ -56,7 +63,9 @@
 
 #include <iterator>
 #include <utility>
+#include <tuple>
 #include <type_traits>
+#include <sys/types.h>
 
 
 namespace zi {
@@ -542,6 +551,117 @@ make_cmp_eq_first(const zip_it<It1,It2>& zit) {
 }
 
 
+/* 3. variadic version: any number of iterators, the elements are tuples;
+ * reftuple is the "reference type" (an std::tuple of references), which
+ * converts to and can be assigned from the value type (std::tuple of the
+ * values); assignment and swap change the referenced elements */
+template<class... T>
+struct reftuple : std::tuple<T...> {
+	typedef std::tuple<typename std::remove_reference<T>::type...> value_type;
+	
+	reftuple(T... x):std::tuple<T...>(x...) { }
+	reftuple(const reftuple<T...>& r):std::tuple<T...>(r) { }
+	
+	/* convert to the value type -- this makes a copy of the elements */
+	operator value_type() const { return value_type(static_cast<const std::tuple<T...>&>(*this)); }
+	
+	reftuple<T...>& operator = (const reftuple<T...>& r) {
+		std::tuple<T...>::operator = (static_cast<const std::tuple<T...>&>(r));
+		return *this;
+	}
+	reftuple<T...>& operator = (const value_type& v) {
+		std::tuple<T...>::operator = (v);
+		return *this;
+	}
+	reftuple<T...>& operator = (value_type&& v) {
+		std::tuple<T...>::operator = (std::move(v));
+		return *this;
+	}
+	
+	void swap(reftuple<T...>& r) { swap_impl(r, std::index_sequence_for<T...>()); }
+	
+	protected:
+		template<size_t... I>
+		void swap_impl(reftuple<T...>& r, std::index_sequence<I...>) {
+			using std::swap;
+			int dummy[] = { (swap(std::get<I>(*this), std::get<I>(r)), 0)... };
+			(void)dummy;
+		}
+};
+
+template<class... T>
+void swap(reftuple<T...>&& r1, reftuple<T...>&& r2) {
+	r1.swap(r2);
+}
+
+template<class... T>
+void swap(reftuple<T...>& r1, reftuple<T...>& r2) {
+	r1.swap(r2);
+}
+
+/* zipped iterator of any number of iterators; these should refer to ranges
+ * of the same length: differences and comparisons use the first iterator */
+template<class... It>
+struct zip_itn {
+	protected:
+		std::tuple<It...> its;
+		typedef std::index_sequence_for<It...> idx;
+		
+		template<size_t... I>
+		void add(ssize_t x, std::index_sequence<I...>) {
+			int dummy[] = { ((std::get<I>(its) += x), 0)... };
+			(void)dummy;
+		}
+		template<size_t... I>
+		reftuple<typename std::iterator_traits<It>::reference...> get(ssize_t x, std::index_sequence<I...>) const {
+			return reftuple<typename std::iterator_traits<It>::reference...>(std::get<I>(its)[x]...);
+		}
+	
+	public:
+		typedef typename std::iterator_traits<typename std::tuple_element<0,std::tuple<It...> >::type>::iterator_category iterator_category;
+		typedef std::tuple<typename std::iterator_traits<It>::value_type...> value_type;
+		typedef reftuple<typename std::iterator_traits<It>::reference...> reference;
+		typedef reference pointer;
+		typedef ssize_t difference_type;
+		
+		zip_itn() = delete;
+		zip_itn(const It&... it):its(it...) { }
+		
+		/* dereferencing and array access -- only works for random access iterators */
+		reference operator*() const { return get(0, idx()); }
+		reference operator [] (ssize_t i) const { return get(i, idx()); }
+		
+		/* increment / decrement */
+		zip_itn<It...> operator++(int) { auto tmp = *this; add(1, idx()); return tmp; }
+		zip_itn<It...>& operator++() { add(1, idx()); return *this; }
+		zip_itn<It...> operator--(int) { auto tmp = *this; add(-1, idx()); return tmp; }
+		zip_itn<It...>& operator--() { add(-1, idx()); return *this; }
+		zip_itn<It...>& operator+=(ssize_t x) { add(x, idx()); return *this; }
+		zip_itn<It...>& operator-=(ssize_t x) { add(-x, idx()); return *this; }
+		zip_itn<It...> operator+(ssize_t x) const { auto r(*this); r += x; return r; }
+		zip_itn<It...> operator-(ssize_t x) const { auto r(*this); r -= x; return r; }
+		ssize_t operator-(const zip_itn<It...>& r) const { return std::get<0>(its) - std::get<0>(r.its); }
+		
+		/* comparisons */
+		bool operator==(const zip_itn<It...>& r) const { return std::get<0>(its) == std::get<0>(r.its); }
+		bool operator!=(const zip_itn<It...>& r) const { return std::get<0>(its) != std::get<0>(r.its); }
+		bool operator< (const zip_itn<It...>& r) const { return std::get<0>(its) <  std::get<0>(r.its); }
+		bool operator<=(const zip_itn<It...>& r) const { return std::get<0>(its) <= std::get<0>(r.its); }
+		bool operator> (const zip_itn<It...>& r) const { return std::get<0>(its) >  std::get<0>(r.its); }
+		bool operator>=(const zip_itn<It...>& r) const { return std::get<0>(its) >= std::get<0>(r.its); }
+		
+		/* access to the individual iterators (see get_it1() above) */
+		template<size_t I>
+		const typename std::tuple_element<I,std::tuple<It...> >::type& get_it() const { return std::get<I>(its); }
+};
+
+/* template function to create a zipped iterator deducing types automatically */
+template<class... It>
+zip_itn<It...> make_zip_itn(It... it) {
+	return zip_itn<It...>(it...);
+}
+
+
 }
 
 
@@ -0,0 +1,122 @@
+/*
+ * nodedeg.cpp -- pontok bejövő fokszámai egy élettartamhoz, 16 bites számlálókkal
+ *
+ * Copyright 2020 Kondor Dániel <kondor.dani@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "nodedeg.h"
+#include "memplace.h"
+
+
+int nodedeg::init(nodeid N1) {
+	clean();
+	c = (uint16_t*)memplace_alloc(N1*sizeof(uint16_t));
+	if(!c) return 1;
+	hub = (unsigned int*)calloc(NODEDEG_SLOTS, sizeof(unsigned int));
+	if(!hub) {
+		clean();
+		return 1;
+	}
+	hub_node.resize(NODEDEG_SLOTS);
+	N = N1;
+	return 0;
+}
+
+void nodedeg::clean() {
+	if(c) memplace_free(c);
+	c = nullptr;
+	if(hub) free(hub);
+	hub = nullptr;
+	N = 0;
+	nhub = 0;
+	hub_node.clear();
+	ovf.clear();
+}
+
+unsigned int nodedeg::get_ovf(nodeid i) const {
+	std::unique_lock<std::mutex> lock(m);
+	return ovf.find(i)->second;
+}
+
+void nodedeg::inc_ovf(nodeid i) {
+	std::unique_lock<std::mutex> lock(m);
+	if(c[i] != NODEDEG_OVF) {
+		//most lesz hub: új sorszám, ha van még
+		if(nhub < NODEDEG_SLOTS) {
+			hub[nhub] = NODEDEG_HUB;
+			hub_node[nhub] = i;
+			c[i] = (uint16_t)(NODEDEG_HUB + nhub);
+			nhub++;
+		}
+		else {
+			c[i] = NODEDEG_OVF;
+			ovf[i] = NODEDEG_HUB;
+		}
+	}
+	else ovf[i]++;
+}
+
+void nodedeg::dec_ovf(nodeid i) {
+	std::unique_lock<std::mutex> lock(m);
+	auto it = ovf.find(i);
+	unsigned int x = --(it->second);
+	if(x < NODEDEG_HUB) {
+		//már elfér a számlálóban
+		c[i] = (uint16_t)x;
+		ovf.erase(it);
+	}
+}
+
+void nodedeg::ovf_save(std::vector<uint64_t>& v) {
+	std::unique_lock<std::mutex> lock(m);
+	v.clear();
+	for(unsigned int j=0;j<nhub;j++) {
+		v.push_back(hub_node[j]);
+		v.push_back(hub[j]);
+	}
+	for(const auto& x : ovf) {
+		v.push_back(x.first);
+		v.push_back(x.second);
+	}
+}
+
+int nodedeg::ovf_load(const uint64_t* v, size_t n) {
+	std::unique_lock<std::mutex> lock(m);
+	ovf.clear();
+	nhub = 0;
+	size_t nslots = 0;
+	for(size_t j=0;j<n;j++) {
+		uint64_t i = v[2*j];
+		uint64_t x = v[2*j+1];
+		if(i >= N || c[i] < NODEDEG_HUB || x > UINT32_MAX) return 1;
+		if(c[i] == NODEDEG_OVF) {
+			if(x < NODEDEG_HUB) return 1;
+			ovf[(nodeid)i] = (unsigned int)x;
+		}
+		else {
+			//a sorszámok folyamatosan vannak kiosztva
+			unsigned int k = c[i] - NODEDEG_HUB;
+			hub[k] = (unsigned int)x;
+			hub_node[k] = (nodeid)i;
+			if(k >= nhub) nhub = k + 1;
+			nslots++;
+		}
+	}
+	return nslots == nhub ? 0 : 1;
+}
+
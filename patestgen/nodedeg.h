@@ -0,0 +1,104 @@
+/*
+ * nodedeg.h -- pontok bejövő fokszámai egy élettartamhoz, 16 bites számlálókkal
+ *
+ * most nodes have a small degree, so the degrees are stored as 16-bit
+ * counters (half of the memory and cache footprint of unsigned int); the
+ * few nodes that reach a degree of NODEDEG_HUB (hubs) get a slot in a small
+ * dense array of full-size counters instead, and their 16-bit counter stores
+ * NODEDEG_HUB + the index of the slot; so updating the degree of a hub (these
+ * are the nodes with the most transactions) is only one more array access;
+ * a hub keeps its slot even if its degree decreases later; if all
+ * NODEDEG_SLOTS slots are used, further hubs have NODEDEG_OVF in their counter,
+ * and their degree is stored in a hash table
+ * 
+ * with -T, several threads change the degrees at the same time (each one
+ * only of its own nodes, so also of its own slots); only assigning a new
+ * slot and the hash table are protected by a mutex (these are rare)
+ * 
+ * Copyright 2020 Kondor Dániel <kondor.dani@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+
+#ifndef NODEDEG_H
+#define NODEDEG_H
+#include "idlist.h"
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+#define NODEDEG_HUB 0x8000U //ennél nagyobb vagy egyenlő fokszám a hub-ok tömbjében van
+#define NODEDEG_OVF 0xFFFFU //a hub-ok tömbje megtelt, a fokszám a hash táblában van
+#define NODEDEG_SLOTS (NODEDEG_OVF - NODEDEG_HUB) //hub-ok tömbjének mérete
+
+class nodedeg {
+	public:
+		uint16_t* c; //számlálók (N darab), vagy NODEDEG_HUB + a hub sorszáma, vagy NODEDEG_OVF
+		unsigned int* hub; //hub-ok fokszámai (NODEDEG_SLOTS darab)
+		nodeid N;
+		
+		nodedeg() { c = nullptr; hub = nullptr; N = 0; nhub = 0; }
+		~nodedeg() { clean(); }
+		nodedeg(const nodedeg&) = delete;
+		nodedeg& operator = (const nodedeg&) = delete;
+		
+		//N1 pont fokszámainak lefoglalása (mind 0) -- eredmény: 0, ha sikerült
+		int init(nodeid N1);
+		//memória felszabadítása
+		void clean();
+		
+		//i. pont fokszáma
+		unsigned int get(nodeid i) const {
+			uint16_t x = c[i];
+			if(x < NODEDEG_HUB) return x;
+			if(x != NODEDEG_OVF) return hub[x - NODEDEG_HUB];
+			return get_ovf(i);
+		}
+		//fokszám növelése / csökkentése (csökkenteni csak pozitív fokszámot lehet)
+		void inc(nodeid i) {
+			uint16_t x = c[i];
+			if(x < NODEDEG_HUB - 1) c[i] = x + 1;
+			else if(x >= NODEDEG_HUB && x != NODEDEG_OVF) hub[x - NODEDEG_HUB]++;
+			else inc_ovf(i);
+		}
+		void dec(nodeid i) {
+			uint16_t x = c[i];
+			if(x < NODEDEG_HUB) c[i] = x - 1;
+			else if(x != NODEDEG_OVF) hub[x - NODEDEG_HUB]--;
+			else dec_ovf(i);
+		}
+		void prefetch(nodeid i) const { __builtin_prefetch(c + i, 1); }
+		
+		//checkpoint: a hub-ok (és a hash tábla) tartalma (pont, fokszám) párokként
+		void ovf_save(std::vector<uint64_t>& v);
+		//visszaállítás ovf_save() eredményéből (a számlálókat előtte kell beállítani)
+		//	-- eredmény: 0, ha rendben volt
+		int ovf_load(const uint64_t* v, size_t n);
+		
+	protected:
+		unsigned int nhub; //kiosztott hub sorszámok
+		std::vector<nodeid> hub_node; //az egyes sorszámokhoz tartozó pontok (checkpoint-hoz)
+		std::unordered_map<nodeid,unsigned int> ovf; //fokszámok, ha a hub-ok tömbje megtelt
+		mutable std::mutex m; //új hub sorszám kiosztása és ovf védelme (-T)
+		
+		unsigned int get_ovf(nodeid i) const;
+		void inc_ovf(nodeid i);
+		void dec_ovf(nodeid i);
+};
+
+#endif
+
@@ -23,8 +23,16 @@
  * 	type == 4 if the transaction is made on an existing (active) edge
  * 	type == 5 if the transaction is reacitvating a previously deactivated edge
  * 
+ * with the -K option, the degree decreases of the edges expiring at the same
+ * time are coalesced: a node that lost k > 1 edges gets one event instead of k
+ * type 0 events, with its new degree as an additional column after the degree:
+ * 		6	degree	new_degree	timestamp	is_contract
+ * (no rank calculation is done between these, so the degrees seen by the
+ * events of types 2 -- 5 are the same; ptr and indeg_dist apply these as one
+ * change in the tree)
+ * 
  * additions for Ethereum, separate transactions with contracts
- * 	for types 0/1, is_contract is nonzero if it refers to a degree of a contract
+ * 	for types 0/1/6, is_contract is nonzero if it refers to a degree of a contract
  * 	for types >= 2, is_contract has the following meanings:
  * 		0 if both nodes are regular addresses
  * 		1 if the sender is a regular address and the receiver is a contract
@@ -33,6 +41,78 @@
  * 
  * these are only output if info about contracts is provided
  * 
+ * with the -X option, node IDs in the list of edges are replaced by their
+ * index once after reading (see ids_replace() in edges.h), so that these do
+ * not need to be looked up again for each edge processed or deleted
+ * 
+ * with the -h option, edges are looked up using a hash table (instead of a
+ * binary search or with the per-node offsets created with the -H option)
+ * 
+ * edges expire in the order of their last activity (as all edges have the
+ * same lifetime), so these are kept in a simple queue (see edgequeue.h);
+ * this requires the transactions to be sorted by time; with the -E option,
+ * a binary heap ordered by the time of last activity is used instead
+ * 
+ * the lists of IDs and edges are parsed in parallel (see chunkread.h); the
+ * number of threads used for this can be given with the -j option (default:
+ * all available CPUs)
+ * 
+ * with the -C option, the processed lists of IDs and edges (after sorting,
+ * and -X and -H if given) are saved in the given cache file; later runs with
+ * the same input files and options map the cache file directly instead of
+ * reading the input again (see idcache.h)
+ * 
+ * with the -B option, the same events are written in a compact binary format
+ * instead (see evbin.h), which can be read directly by ptr and indeg_dist (-b)
+ * 
+ * with the -b option, the transactions are read from a binary file instead of
+ * text: either raw 12-byte records (three 32-bit numbers), or a compressed file
+ * (delta-coded EVBIN_TX records, see evbin.h) that is decoded one chunk at a
+ * time; the latter can be created from the text input by etsbin (see
+ * misc/edges_ts_bin.cpp)
+ * 
+ * node IDs are 32-bit by default; for datasets with larger IDs (or more than
+ * 2^32-1 nodes), compile with -DPTG_ID64 (built as ptg64 by compile_programs.sh),
+ * this uses twice as much memory for the edges and IDs; the arrays indexed by
+ * edges (heap positions, the expiry queue and the hash index) use 4 bytes per
+ * element, or 5 bytes if there are at least 2^32-1 edges (see edgeidx_width()
+ * in edges.h), so no option is needed for that
+ * 
+ * with the -R option, ranks are calculated directly from the events (as done
+ * by ptr, see patestrun/ranks.h), in a separate thread for each -R option given;
+ * its argument is a lifetime followed by the options as given to ptr, e.g.
+ * 	-R "30d -o ptrm -m -a 0.5 1.0 -H -T 6m"
+ * in this case, events are only written out if an output file name is
+ * given with -o as well
+ *
+ * with the -T option, the transactions are processed by the given number of
+ * threads, each handling the edges into a subset of the nodes; the events are
+ * merged in the same order as without this option (see ptg_par below; this
+ * cannot be used together with -E or -P)
+ *
+ * with the -P option, the state is saved periodically in the given file
+ * (by default every hour, or as given after the file name, e.g. -P ptg.ckpt 2h);
+ * after an interruption, running again with the same options and --resume
+ * continues from the last checkpoint, giving the same output as an
+ * uninterrupted run; the checkpoint is written by a forked process in the
+ * background (see checkpoint.h), and deleted at the end of a successful run;
+ * this requires output files (-o) and cannot be used with -R
+ *
+ * with the -M option, the large arrays (edges, edge states, the queue or heap
+ * of edges, node degrees) are allocated with the given placement policy, a
+ * comma-separated list of: thp (transparent huge pages), hugetlb (explicit
+ * huge pages, these need to be reserved by the admin), interleave (pages
+ * interleaved among NUMA nodes), prefault (all pages touched right after
+ * allocation, using -j threads), e.g. -M thp,interleave; a summary of the
+ * policy in effect is printed at the end (see memplace.h)
+ *
+ * with the -m option, a memory budget can be given (e.g. -m 32G); if the
+ * estimated memory use is above it, the sorted array of edges (and the
+ * helper or hash index) is replaced by a compressed index (Elias-Fano coding
+ * of the node indices, see edgeef.h) after reading, which needs about
+ * log2(N^2 / edges) + 3 bits per edge instead of 8 (16 with 64-bit IDs);
+ * the output is the same, lookups are somewhat slower; -m 0 always uses it
+ *
  * Copyright 2015-2020 Kondor Dániel <kondor.dani@gmail.com>
  * 
  * Redistribution and use in source and binary forms, with or without
@@ -70,7 +150,16 @@
 #include "idlist.h"
 #include "edges.h"
 #include "edgeheap.h"
+#include "edgequeue.h"
+#include "nodedeg.h"
+#include "idcache.h"
+#include "checkpoint.h"
+#include "zfile.h"
+#include "zout.h"
 #include "read_table.h"
+#include "evbin.h"
+#include "evqueue.h"
+#include "ranks.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -79,6 +168,13 @@
 #include <ctype.h>
 #include <time.h>
 
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -87,18 +183,26 @@
 
 
 typedef struct edgerecord_t { //egy bejegyzés az eléket tartalmazó fájlban
-	unsigned int in;
-	unsigned int out;
+	nodeid in;
+	nodeid out;
 	unsigned int timestamp;
 } erecord;
 
+/* record in the raw binary input (-b): always 12 bytes, so only with 32-bit IDs */
+typedef struct erecord_raw_t {
+	uint32_t in;
+	uint32_t out;
+	uint32_t timestamp;
+} erecord_raw;
+
 //egy új bejegyzés beolvasása (ha van még a fájlban)
-static int erecord_read(read_table* f, erecord* r, int ignore_invalid) {
+static inline int erecord_read(read_table* f, erecord* r, int ignore_invalid) {
 	while(1) {
 		if(read_table_line(f)) return -1;
 		
-		unsigned int in,out,timestamp;
-		if(read_table_uint32(f,&in) || read_table_uint32(f,&out)) {
+		nodeid in,out;
+		unsigned int timestamp;
+		if(read_table_next(f,in) || read_table_next(f,out)) {
 			if(ignore_invalid && read_table_get_last_error(f) == T_OVERFLOW) continue;
 			else return -1;
 		}
@@ -110,14 +214,21 @@ static int erecord_read(read_table* f, erecord* r, int ignore_invalid) {
 	}
 }
 
-static char gzip0[] = "/usr/bin/zip";
-static char zcat[] = "/bin/zcat";
-
+/* binary input (-b): either raw records (erecord_raw, 12 bytes each),
+ * or a file with EVBIN_TX records (see evbin.h, created by misc/edges_ts_bin.cpp),
+ * which is decoded one chunk at a time */
 typedef struct erecord_bin_t {
-	const erecord* e;
-	uint64_t size;
-	uint64_t ix;
+	const erecord_raw* e;
+	uint64_t size; /* number of records */
+	uint64_t ix; /* index of the next record */
 	int fd;
+	evbin_reader evr; /* used if packed != 0 */
+	int packed;
+	evbin_tx* buf; /* current chunk, decoded */
+	uint32_t nbuf;
+	uint32_t ibuf;
+	int error; /* reading stopped because of an error, not the end of the file */
+	int ignore_invalid; /* skip records with IDs that do not fit in nodeid (otherwise an error) */
 } erecord_bin;
 
 static int erecord_bin_open(erecord_bin* r, const char* fn) {
@@ -126,38 +237,119 @@ static int erecord_bin_open(erecord_bin* r, const char* fn) {
 	uint64_t fs;
 	void* map;
 	
+	r->e = NULL;
+	r->size = 0;
+	r->ix = 0;
+	r->fd = -1;
+	r->packed = 0;
+	r->buf = NULL;
+	r->nbuf = 0;
+	r->ibuf = 0;
+	r->error = 0;
 	fd = open(fn,O_CLOEXEC | O_RDONLY | O_NOATIME);
 	if(fd == -1) return 1;
-	if(fstat(fd,&tmp) == -1 || !tmp.st_size || tmp.st_size % sizeof(erecord)) {
+	char magic[4];
+	if(fstat(fd,&tmp) == -1 || !tmp.st_size) {
+		close(fd);
+		return 1;
+	}
+	if(tmp.st_size >= (off_t)evbin_header_size && pread(fd,magic,4,0) == 4 && !memcmp(magic,evbin_magic,4)) {
+		close(fd);
+		if(evbin_open(&(r->evr),fn,EVBIN_TX)) return 1;
+		r->buf = (evbin_tx*)malloc(sizeof(evbin_tx)*evbin_chunk_records);
+		if(!r->buf) {
+			evbin_close(&(r->evr));
+			return 1;
+		}
+		r->packed = 1;
+		r->size = r->evr.idx ? r->evr.total : UINT64_MAX; /* size is unknown without the index */
+		return 0;
+	}
+	if(tmp.st_size % sizeof(erecord_raw)) {
 		close(fd);
 		return 1;
 	}
 	fs = tmp.st_size;
-	r->size = fs / sizeof(erecord);
+	r->size = fs / sizeof(erecord_raw);
 	map = mmap(0UL,fs,PROT_READ,MAP_SHARED,fd,0UL);
 	if(map == MAP_FAILED) {
 		close(fd);
 		return 1;
 	}
-	r->e = (const erecord*)map;
+	madvise(map,fs,MADV_SEQUENTIAL);
+	r->e = (const erecord_raw*)map;
 	r->ix = 0;
 	r->fd = fd;
 	return 0;
 }
 
-static int erecord_bin_read(erecord_bin* r, erecord* e) {
+/* read the next record from a file with EVBIN_TX records (r->packed != 0) */
+static inline int erecord_bin_read_packed(erecord_bin* r, erecord* e) {
+	while(1) {
+		if(r->ibuf == r->nbuf) {
+			r->ibuf = 0;
+			int res = evbin_read_tx_chunk(&(r->evr),r->buf,&(r->nbuf));
+			if(res) {
+				if(res < 0) r->error = 1;
+				return 1;
+			}
+		}
+		const evbin_tx* x = r->buf + r->ibuf;
+		r->ibuf++;
+		r->ix++;
+		/* IDs that do not fit are handled the same way as overflow in the text input */
+		if(x->in != (nodeid)(x->in) || x->out != (nodeid)(x->out)) {
+			if(r->ignore_invalid) continue;
+			fprintf(stderr,"Node ID does not fit in 32 bits in record %lu (compile with -DPTG_ID64)!\n",r->ix);
+			r->error = 1;
+			return 1;
+		}
+		e->in = x->in;
+		e->out = x->out;
+		e->timestamp = x->ts;
+		return 0;
+	}
+}
+
+/* read the next raw record (r->packed == 0) */
+static inline int erecord_bin_read_raw(erecord_bin* r, erecord* e) {
 	if(r->ix >= r->size) return 1;
-	*e = r->e[r->ix];
+	const erecord_raw* x = r->e + r->ix;
+	e->in = x->in;
+	e->out = x->out;
+	e->timestamp = x->timestamp;
 	r->ix++;
 	return 0;
 }
 
+static int erecord_bin_read(erecord_bin* r, erecord* e) {
+	return r->packed ? erecord_bin_read_packed(r,e) : erecord_bin_read_raw(r,e);
+}
+
+/* continue reading from the n-th record -- returns 0 on success */
+static int erecord_bin_seek(erecord_bin* r, uint64_t n) {
+	if(n > r->size) return 1;
+	if(r->packed) {
+		r->nbuf = 0;
+		r->ibuf = 0;
+		if(evbin_seek(&(r->evr),n)) return 1;
+	}
+	r->ix = n;
+	return 0;
+}
+
 static void erecord_bin_close(erecord_bin* r) {
+	if(r->packed) {
+		evbin_close(&(r->evr));
+		free(r->buf);
+		r->buf = NULL;
+		r->packed = 0;
+	}
 	if(r->e) {
-		munmap((void*)r->e, sizeof(erecord) * (r->size));
+		munmap((void*)r->e, sizeof(erecord_raw) * (r->size));
 		r->e = NULL;
 	}
-	if(r->fd) {
+	if(r->fd >= 0) {
 		close(r->fd),
 		r->fd = -1;
 	}
@@ -194,6 +386,1203 @@ int strtodint(char* a,unsigned int* delay) {
 }
 
 
+/* memory size with an optional K, M, G or T suffix (powers of 1024), e.g. 32G */
+int strtosize(const char* a, uint64_t* size) {
+	char* a1 = 0;
+	uint64_t size2 = strtoull(a,&a1,10);
+	if(a1 == a) return 1;
+	switch(*a1) {
+		case 'T':
+		case 't':
+			size2 *= 1024UL;
+			/* fallthrough */
+		case 'G':
+		case 'g':
+			size2 *= 1024UL;
+			/* fallthrough */
+		case 'M':
+		case 'm':
+			size2 *= 1024UL;
+			/* fallthrough */
+		case 'K':
+		case 'k':
+			size2 *= 1024UL;
+			break;
+		case 0:
+			break;
+		default:
+			return 1;
+	}
+	*size = size2;
+	return 0;
+}
+
+
+/* rank calculation on the events of one lifetime (-R option), done in a
+ * separate thread, events are passed to it through an in-memory queue */
+typedef struct ptg_ranks_t {
+	char* str; //copy of the -R parameter, split into words
+	std::vector<char*> args; //lifetime + options as given to ptr
+	size_t lt; //index of the lifetime used
+	ranks_options opts;
+	ranks_calc* calc;
+	evqueue q;
+	std::thread th;
+	int err;
+} ptg_ranks;
+
+/* degree decrease of an expired edge, not written out yet (-K, see ptg_degdec()) */
+typedef struct ptg_pending_dec_t {
+	nodeid node;
+	unsigned int deg; /* degree before the decrease */
+	int contract;
+} ptg_pending_dec;
+
+/* state kept separately for each edge lifetime that is evaluated
+ * (the edges and the node IDs are shared among these) */
+typedef struct ptg_lifetime_t {
+	unsigned int delay; //linkek élettartama (0: végtelen)
+	const char* delay_str; //as given on the command line, used in output file names
+	nodedeg inlinks; //bejövő linkek száma ezzel az élettartammal
+	edgestate es; //élek utolsó aktivitása és heap-beli helye
+	edgeheap eh; /* edges ordered by expiry time, only used with -E */
+	edgequeue eq; /* otherwise, edges in the order of their last activity (see edgequeue.h) */
+	int use_heap;
+	int compact; /* coalesce the degree decreases of edges expiring at the same time (-K) */
+	std::vector<ptg_pending_dec> dd; /* decreases not written out yet, all with the timestamp dd_ts */
+	unsigned int dd_ts;
+	size_t ntypes[7]; /* count the different types of output */
+	zout* zo; /* text output (compressed in parallel, see zout.h); NULL if not used */
+	FILE* out; /* binary output file, used by evb */
+	evbin_writer* evb; /* if not NULL, output is written in binary format with this */
+	std::vector<ptg_ranks*> ranks; /* rank calculations using these events */
+} ptg_lifetime;
+
+/* write out one event (deg2 is the new degree for type 6) */
+static inline void ptg_event(ptg_lifetime* lt, unsigned int type, unsigned int deg, unsigned int ts,
+		int contract, int have_contracts, unsigned int deg2 = 0) {
+	for(ptg_ranks* pr : lt->ranks)
+		if(pr->opts.contract_filter < 0 || pr->opts.contract_filter == contract)
+			pr->q.push(type,deg,ts,contract,deg2);
+	if(lt->evb) evbin_write_deg(lt->evb,type,deg,ts,contract,deg2);
+	else if(lt->zo) {
+		zout* z = lt->zo;
+		z->write_uint(type);
+		z->put('\t');
+		z->write_uint(deg);
+		z->put('\t');
+		if(type == 6) {
+			z->write_uint(deg2);
+			z->put('\t');
+		}
+		z->write_uint(ts);
+		if(have_contracts) {
+			z->put('\t');
+			z->write_int(contract);
+		}
+		z->put('\n');
+	}
+	lt->ntypes[type]++;
+}
+
+/* write out the degree decreases collected by ptg_degdec(): sorted by node,
+ * so that the decreases of the same node are next to each other, with the
+ * highest degree first; a node with more than one decrease gets one type 6
+ * event -- note: the order of the degree changes with the same timestamp
+ * does not matter, as no rank calculation is done in between */
+static void ptg_degdec_flush(ptg_lifetime* lt, int have_contracts) {
+	std::vector<ptg_pending_dec>& dd = lt->dd;
+	std::sort(dd.begin(),dd.end(),[](const ptg_pending_dec& x, const ptg_pending_dec& y) {
+		return x.node < y.node || (x.node == y.node && x.deg > y.deg);
+	});
+	for(size_t j=0;j<dd.size();) {
+		size_t j2 = j+1;
+		while(j2 < dd.size() && dd[j2].node == dd[j].node) j2++;
+		if(j2 == j+1) ptg_event(lt,0,dd[j].deg,lt->dd_ts,dd[j].contract,have_contracts);
+		else ptg_event(lt,6,dd[j].deg,lt->dd_ts,dd[j].contract,have_contracts,dd[j].deg - (unsigned int)(j2-j));
+		j = j2;
+	}
+	dd.clear();
+}
+
+/* decrease of the degree of node from deg at time ts (an edge expired): written
+ * out directly, or with -K, collected until all edges expiring at the same
+ * time are processed (the caller should call ptg_degdec_flush() after the last
+ * one) */
+static inline void ptg_degdec(ptg_lifetime* lt, nodeid node, unsigned int deg, unsigned int ts,
+		int contract, int have_contracts) {
+	if(!lt->compact) {
+		ptg_event(lt,0,deg,ts,contract,have_contracts);
+		return;
+	}
+	if(!lt->dd.empty() && ts != lt->dd_ts) ptg_degdec_flush(lt,have_contracts);
+	lt->dd_ts = ts;
+	ptg_pending_dec x;
+	x.node = node;
+	x.deg = deg;
+	x.contract = contract;
+	lt->dd.push_back(x);
+}
+
+/* parse the parameter of the -R option: split into words, the first one is the
+ * lifetime, the rest are options to the rank calculation -- returns 0 on success */
+static int ptg_ranks_parse(ptg_ranks* pr, const char* arg, unsigned int* delay) {
+	pr->str = strdup(arg);
+	if(!pr->str) return 1;
+	for(char* tmp = strtok(pr->str," \t"); tmp; tmp = strtok(0," \t")) pr->args.push_back(tmp);
+	if(pr->args.empty() || strtodint(pr->args[0],delay)) return 1;
+	int n = pr->args.size();
+	pr->args.push_back(0);
+	for(int i=1;i<n;i++) if(!ranks_parse_arg(pr->opts,n,pr->args.data(),i)) {
+		fprintf(stderr,"Unknown parameter for rank calculation: %s!\n",pr->args[i]);
+		return 1;
+	}
+	if(pr->opts.a.empty()) {
+		fprintf(stderr,"Exponents (-a) are required for rank calculation!\n");
+		return 1;
+	}
+	return 0;
+}
+
+/* stop the thread if still running and free all memory used */
+static void ptg_ranks_free(ptg_ranks* pr) {
+	if(pr->th.joinable()) {
+		pr->q.close();
+		pr->th.join();
+	}
+	if(pr->calc) delete pr->calc;
+	if(pr->str) free(pr->str);
+	delete pr;
+}
+
+/* process events from the queue (run in a separate thread) */
+static void ptg_ranks_run(ptg_ranks* pr) {
+	const evqueue_event* b;
+	size_t n;
+	while( (n = pr->q.pop(&b)) ) {
+		if(pr->err) continue; /* skip all remaining events after an error */
+		try {
+			for(size_t j=0;j<n;j++) pr->calc->event(b[j].type,b[j].deg,b[j].ts,b[j].deg2);
+		}
+		catch(std::exception& ex) {
+			fprintf(stderr,"Error calculating ranks (%s): %s",pr->opts.outf_base,ex.what());
+			pr->err = 1;
+		}
+	}
+}
+
+
+/* checkpoints (-P, see checkpoint.h): the state after processing a
+ * transaction; the file contains a ptg_ckpt_header, il->sent, and for each
+ * lifetime a ptg_ckpt_lt, followed by its arrays (the inlinks counters and
+ * their overflow entries, the edge state, the heap or the queue, the output
+ * not yet written to the file and the index of the binary output); finally
+ * the magic number again */
+#define PTG_CKPT_MAGIC 0x3154504B43475450UL //"PTGCKPT1"
+#define PTG_CKPT_VERSION 3
+
+typedef struct ptg_ckpt_header_t {
+	uint64_t magic;
+	uint32_t version;
+	uint32_t flags; /* options that affect the state or the output */
+	uint64_t nlt;
+	uint64_t N;
+	uint64_t nedges;
+	uint64_t in_size[3]; /* size and modification time of the input files (transactions, IDs, edges) */
+	int64_t in_mtime[3];
+	uint64_t pos; /* lines read from the transactions (or records with -b) */
+	uint64_t nedges2;
+	uint64_t DENEXT;
+} ptg_ckpt_header;
+
+typedef struct ptg_ckpt_lt_t {
+	uint64_t delay;
+	uint64_t ntypes[7];
+	uint64_t n; /* number of edges in the heap or the queue */
+	uint64_t novf; /* number of hubs in inlinks, saved as (node, in-degree) pairs (see nodedeg.h) */
+	uint64_t last_ts; /* edgequeue::last_ts */
+	uint64_t out_pos; /* size of the output file */
+	uint64_t out_len; /* data not written to the file yet (current block of zout, or current chunk of evbin) */
+	uint64_t evb_nrec; /* rest of the state of evbin_writer */
+	uint64_t evb_base;
+	uint64_t evb_last;
+	uint64_t evb_total;
+	uint64_t evb_nidx;
+} ptg_ckpt_lt;
+
+/* state of one lifetime read from a checkpoint, used when opening the output */
+typedef struct ptg_resume_lt_t {
+	ptg_ckpt_lt h;
+	std::vector<char> data;
+	std::vector<uint64_t> idx;
+} ptg_resume_lt;
+
+/* header with the parameters of this run, the state is filled in later */
+static int ptg_ckpt_init(ptg_ckpt_header* hdr, const char* fn[3], uint32_t flags, size_t nlt,
+		const idlist* il, const edges* ee) {
+	memset(hdr,0,sizeof(ptg_ckpt_header));
+	hdr->magic = PTG_CKPT_MAGIC;
+	hdr->version = PTG_CKPT_VERSION;
+	hdr->flags = flags;
+	hdr->nlt = nlt;
+	hdr->N = il->N;
+	hdr->nedges = ee->nedges;
+	for(int i=0;i<3;i++) {
+		struct stat st;
+		if(stat(fn[i],&st)) return 1;
+		hdr->in_size[i] = st.st_size;
+		hdr->in_mtime[i] = st.st_mtime;
+	}
+	return 0;
+}
+
+/* start writing a checkpoint (hdr should contain the current position);
+ * the output files are flushed first, so that the checkpoint refers to
+ * data that is already in them -- returns 0 on success */
+static int ptg_checkpoint(ckpt* c, ptg_ckpt_header* hdr, ptg_lifetime* lts, size_t nlt, const idlist* il) {
+	std::vector<ptg_ckpt_lt> lth(nlt);
+	std::vector<std::vector<uint64_t> > ovf(nlt);
+	std::vector<ckpt_seg> segs;
+	segs.push_back({hdr, sizeof(ptg_ckpt_header)});
+	segs.push_back({il->sent, ids_bitset_size(il->N)});
+	for(size_t k=0;k<nlt;k++) {
+		ptg_lifetime* lt = lts + k;
+		ptg_ckpt_lt& h = lth[k];
+		memset(&h,0,sizeof(ptg_ckpt_lt));
+		h.delay = lt->delay;
+		for(int i=0;i<7;i++) h.ntypes[i] = lt->ntypes[i];
+		const char* data = 0;
+		if(lt->evb) {
+			evbin_writer* w = lt->evb;
+			if(w->error || fflush(lt->out)) return 1;
+			h.out_pos = w->pos;
+			h.out_len = w->len;
+			data = (const char*)w->buf;
+			h.evb_nrec = w->nrec;
+			h.evb_base = w->base;
+			h.evb_last = w->last;
+			h.evb_total = w->total;
+			h.evb_nidx = w->nidx;
+		}
+		else if(lt->zo) {
+			size_t len;
+			if(lt->zo->checkpoint(&h.out_pos,&data,&len)) return 1;
+			h.out_len = len;
+		}
+		lt->inlinks.ovf_save(ovf[k]);
+		h.novf = ovf[k].size() / 2;
+		segs.push_back({&h, sizeof(ptg_ckpt_lt)});
+		segs.push_back({lt->inlinks.c, il->N*sizeof(uint16_t)});
+		if(h.novf) segs.push_back({ovf[k].data(), 2*h.novf*sizeof(uint64_t)});
+		const edgestate& es = lt->es;
+		if(es.ts) segs.push_back({es.ts, es.n*sizeof(unsigned int)});
+		if(es.off) segs.push_back({es.off, es.n*es.off_width});
+		if(es.seen) segs.push_back({es.seen, (es.n/64 + 1)*sizeof(uint64_t)});
+		if(lt->delay > 0) {
+			if(lt->use_heap) {
+				h.n = lt->eh.hn;
+				if(h.n) segs.push_back({lt->eh.heap, h.n*sizeof(uint64_t)});
+			}
+			else {
+				/* the queue is saved from its first element (it may wrap around in the buffer),
+				 * without the entries of edges that were active again later */
+				edgequeue& eq = lt->eq;
+				eq.compact();
+				h.n = eq.tail - eq.head;
+				h.last_ts = eq.last_ts;
+				if(h.n) {
+					uint64_t i1 = eq.head & (eq.qsize - 1);
+					uint64_t n1 = eq.qsize - i1;
+					if(n1 > h.n) n1 = h.n;
+					segs.push_back({eq.q + i1*eq.isize, n1*eq.isize});
+					if(n1 < h.n) segs.push_back({eq.q, (h.n - n1)*eq.isize});
+				}
+			}
+		}
+		if(h.out_len) segs.push_back({data, h.out_len});
+		if(h.evb_nidx) segs.push_back({lt->evb->idx, 2*h.evb_nidx*sizeof(uint64_t)});
+	}
+	segs.push_back({&hdr->magic, sizeof(uint64_t)});
+	/* note: the child process gets a copy of lth, ovf and segs, these can be freed here */
+	return ckpt_write(c,segs.data(),segs.size());
+}
+
+/* read the state from a checkpoint file opened as f; hdr0 contains the parameters
+ * of the current run, these should match -- returns 0 on success */
+static int ptg_resume_read(FILE* f, const ptg_ckpt_header* hdr0, ptg_ckpt_header* hdr, ptg_lifetime* lts,
+		size_t nlt, idlist* il, std::vector<ptg_resume_lt>& res) {
+	auto rd = [f](void* p, uint64_t len) { return len && fread(p,1,len,f) != len; };
+	if(rd(hdr,sizeof(ptg_ckpt_header))) return 1;
+	if(hdr->magic != PTG_CKPT_MAGIC || hdr->version != PTG_CKPT_VERSION) {
+		fprintf(stderr,"Not a valid checkpoint file, or created by an incompatible version!\n");
+		return 1;
+	}
+	if(hdr->flags != hdr0->flags || hdr->nlt != hdr0->nlt || hdr->N != hdr0->N || hdr->nedges != hdr0->nedges ||
+			memcmp(hdr->in_size,hdr0->in_size,sizeof(hdr->in_size)) ||
+			memcmp(hdr->in_mtime,hdr0->in_mtime,sizeof(hdr->in_mtime))) {
+		fprintf(stderr,"The checkpoint was created with different input files or options!\n");
+		return 1;
+	}
+	if(rd(il->sent, ids_bitset_size(il->N))) return 1;
+	res.resize(nlt);
+	for(size_t k=0;k<nlt;k++) {
+		ptg_lifetime* lt = lts + k;
+		ptg_ckpt_lt& h = res[k].h;
+		if(rd(&h,sizeof(ptg_ckpt_lt))) return 1;
+		if(h.delay != lt->delay) {
+			fprintf(stderr,"The checkpoint was created with different lifetimes!\n");
+			return 1;
+		}
+		for(int i=0;i<7;i++) lt->ntypes[i] = h.ntypes[i];
+		if(rd(lt->inlinks.c, il->N*sizeof(uint16_t))) return 1;
+		if(h.novf > il->N) return 1;
+		std::vector<uint64_t> ovf(2*h.novf);
+		if(rd(ovf.data(), 2*h.novf*sizeof(uint64_t)) || lt->inlinks.ovf_load(ovf.data(), h.novf)) return 1;
+		edgestate& es = lt->es;
+		if(es.ts && rd(es.ts, es.n*sizeof(unsigned int))) return 1;
+		if(es.off && rd(es.off, es.n*es.off_width)) return 1;
+		if(es.seen && rd(es.seen, (es.n/64 + 1)*sizeof(uint64_t))) return 1;
+		if(lt->delay > 0 && h.n) {
+			if(h.n > es.n) return 1;
+			if(lt->use_heap) {
+				while(lt->eh.hsize < h.n) if(lt->eh.grow()) return 1;
+				if(rd(lt->eh.heap, h.n*sizeof(uint64_t))) return 1;
+				lt->eh.hn = h.n;
+			}
+			else {
+				edgequeue& eq = lt->eq;
+				while(eq.qsize < h.n) if(eq.grow()) return 1;
+				if(rd(eq.q, h.n*eq.isize)) return 1;
+				eq.head = 0;
+				eq.tail = h.n;
+				uint32_t t0 = 0;
+				for(uint64_t i=0;i<h.n;i++) {
+					const unsigned char* x = eq.item(i);
+					uint32_t t1 = eq.item_ts(x);
+					if(eq.item_e(x) >= es.n || t1 < t0 || t1 > h.last_ts) return 1;
+					t0 = t1;
+				}
+			}
+		}
+		if(!lt->use_heap) lt->eq.last_ts = h.last_ts;
+		if(h.out_len > ZOUT_BLOCK + ZOUT_SLACK || h.evb_nidx > h.out_pos) return 1;
+		res[k].data.resize(h.out_len);
+		if(rd(res[k].data.data(), h.out_len)) return 1;
+		res[k].idx.resize(2*h.evb_nidx);
+		if(rd(res[k].idx.data(), 2*h.evb_nidx*sizeof(uint64_t))) return 1;
+	}
+	uint64_t magic = 0;
+	if(rd(&magic,sizeof(uint64_t)) || magic != PTG_CKPT_MAGIC || fgetc(f) != EOF) return 1;
+	return 0;
+}
+
+/* continue writing binary output from the state saved in a checkpoint */
+static int ptg_evbin_resume(evbin_writer* w, FILE* f, uint16_t kind, uint32_t flags, const ptg_resume_lt* res) {
+	const ptg_ckpt_lt& h = res->h;
+	memset(w,0,sizeof(evbin_writer));
+	w->kind = kind;
+	w->flags = flags;
+	size_t buf_size = evbin_chunk_header_size + evbin_chunk_records*evbin_max_record;
+	if(h.out_len < evbin_chunk_header_size || h.out_len > buf_size || h.evb_nrec > evbin_chunk_records) return 1;
+	w->buf = (uint8_t*)malloc(buf_size);
+	if(!w->buf) return 1;
+	memcpy(w->buf, res->data.data(), h.out_len);
+	w->len = h.out_len;
+	w->nrec = h.evb_nrec;
+	w->base = h.evb_base;
+	w->last = h.evb_last;
+	w->pos = h.out_pos;
+	w->total = h.evb_total;
+	if(h.evb_nidx) {
+		w->idx = (uint64_t*)malloc(2*h.evb_nidx*sizeof(uint64_t));
+		if(!w->idx) {
+			free(w->buf);
+			w->buf = 0;
+			return 1;
+		}
+		memcpy(w->idx, res->idx.data(), 2*h.evb_nidx*sizeof(uint64_t));
+		w->nidx = h.evb_nidx;
+		w->idx_size = h.evb_nidx;
+	}
+	w->f = f; /* only set if successful, evbin_writer_close() is not called otherwise */
+	return 0;
+}
+
+/* open the output for one lifetime: stdout if fout == NULL, otherwise
+ * a file named after fout and the lifetime; if res != NULL, an existing
+ * output file is continued from the state in a checkpoint -- returns 0 on success */
+static int ptg_open_output(ptg_lifetime* lt, const char* fout, int out_zip, int out_bin, int have_contracts,
+		const ptg_resume_lt* res) {
+	if(!fout) {
+		if(out_bin) lt->out = stdout;
+		else lt->zo = zout::open(0, ZOUT_PLAIN);
+	}
+	else {
+		char* tmp = (char*)malloc(sizeof(char)*(strlen(fout) + strlen(lt->delay_str) + 40));
+		if(!tmp) return 1;
+		if(out_bin) {
+			/* binary output is not compressed further, so it can be mapped by the readers */
+			sprintf(tmp,"%s-%s.evb",fout,lt->delay_str);
+			if(!res) lt->out = fopen(tmp,"w");
+			else if( (lt->out = fopen(tmp,"r+")) ) {
+				if(ftruncate(fileno(lt->out),res->h.out_pos) || fseeko(lt->out,res->h.out_pos,SEEK_SET)) {
+					fclose(lt->out);
+					lt->out = 0;
+				}
+			}
+		}
+		else {
+			int format = out_zip ? ZOUT_GZIP : ZOUT_PLAIN;
+			sprintf(tmp,out_zip ? "%s-%s.out.gz" : "%s-%s.out",fout,lt->delay_str);
+			if(!res) lt->zo = zout::open(tmp, format);
+			else lt->zo = zout::open_at(tmp, format, res->h.out_pos, res->data.data(), res->h.out_len);
+		}
+		free(tmp);
+	}
+	if(!(lt->out || lt->zo)) return 1;
+	if(out_bin) {
+		lt->evb = (evbin_writer*)malloc(sizeof(evbin_writer));
+		if(!lt->evb) return 1;
+		uint32_t flags = have_contracts ? EVBIN_CONTRACT : 0;
+		if(res ? ptg_evbin_resume(lt->evb,lt->out,EVBIN_DEG,flags,res) :
+			evbin_writer_open(lt->evb,lt->out,EVBIN_DEG,flags)) return 1;
+	}
+	return 0;
+}
+
+/* the serial processing of the transactions (ptg_expire(), ptg_process() and
+ * ptg_run() below) is instantiated separately for each mode of the lifetimes
+ * (given by M) and with or without contracts (C), so that these are decided
+ * at compile time instead of for every transaction */
+#define PTG_LT_SEEN 0 /* lifetime 0 (no expiry): only a bit is kept for each edge */
+#define PTG_LT_QUEUE 1 /* edges expire in the order of the queue */
+#define PTG_LT_HEAP 2 /* edges expire in the order of the heap (-E) */
+#define PTG_LT_MIXED 3 /* only used by ptg_run(): the lifetimes have different modes, chosen for each one */
+
+static inline int ptg_lt_mode(const ptg_lifetime* lt) {
+	if(lt->delay == 0) return PTG_LT_SEEN;
+	return lt->use_heap ? PTG_LT_HEAP : PTG_LT_QUEUE;
+}
+
+/* delete the n-th edge (last active at ts1), decreasing the degree of its
+ * target node -- returns 0 on success, 1 on error */
+template<int C>
+static int ptg_expire1(ptg_lifetime* lt, idlist* il, edges* ee, uint64_t n, unsigned int ts1) {
+	//fokszámok csökkentése
+	//változás a korábbi programhoz képest: az éleknél az eredeti ID-ket tároljuk,
+	//	kivéve, ha már a sorszámokra cseréltük őket (-X)
+	nodeid idin, idout;
+	edges_nodes(ee,il,n,&idin,&idout);
+	if(idin >= il->N || idout >= il->N) { //ez itt nem fordulhat elő, az összes ID-nek szerepelnie kell a felsorolásban
+		fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
+		return 1;
+	}
+	unsigned int deg = lt->inlinks.get(idout);
+	if(deg == 0) { //hiba
+		fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
+		return 1;
+	}
+	ptg_degdec(lt,idout,deg,ts1+lt->delay,C ? (int)ids_contract(il,idout) : 0,C);
+	
+	lt->inlinks.dec(idout);
+	return 0;
+}
+
+/* delete edges that were last active before time1, decreasing the
+ * degree of their target nodes (M is PTG_LT_QUEUE or PTG_LT_HEAP) --
+ * returns 0 on success, 1 on error */
+template<int M, int C>
+static int ptg_expire(ptg_lifetime* lt, idlist* il, edges* ee, unsigned int time1) {
+	if(M == PTG_LT_QUEUE) {
+		uint64_t n;
+		unsigned int ts1;
+		while(lt->eq.pop(time1,&n,&ts1))
+			if(ptg_expire1<C>(lt,il,ee,n,ts1)) return 1;
+	}
+	else {
+		edgeheap& eh = lt->eh;
+		while(eh.hn) {
+			unsigned int ts1 = eh.ts(eh.heap[0]);
+			if(ts1 >= time1) break; //összes él újabb
+			
+			//az eh.heap[0] él régebbi, törölni kell
+			if(ptg_expire1<C>(lt,il,ee,eh.heap[0],ts1)) return 1;
+			
+			eh.del0(); //heap átrendezése (legfelső elem törlése)
+		}
+	}
+	/* with -K, nothing is kept after the current transaction (so checkpoints are not affected) */
+	if(!lt->dd.empty()) ptg_degdec_flush(lt,C);
+	return 0;
+}
+
+/* process one transaction on the eid edge (idin -> idout) with the given lifetime
+ * (M should be ptg_lt_mode(lt))
+ * new_node: the sender did not make any transaction before
+ * returns 0 on success, 1 on error, sets *activated if the edge became active */
+template<int M, int C>
+static int ptg_process(ptg_lifetime* lt, idlist* il, uint64_t eid, nodeid idin, nodeid idout,
+		unsigned int timestamp, int new_node, int* activated) {
+	unsigned int indeg = lt->inlinks.get(idout);
+	unsigned int type = 2; /* default: new edge */
+	int new1 = 0; //0, ha aktív az él, ekkor semmit sem kell csinálni
+		//1, ha már szerepelt ez az él, de nem volt aktív (delay-nél nagyobb idő óta)
+		//2, ha még nem szerepelt (timestamp == 0)
+	unsigned int time1 = 0;
+	if(M != PTG_LT_SEEN && timestamp > lt->delay) time1 = timestamp - lt->delay;
+	
+	if(M == PTG_LT_SEEN) { if(!edgestate_seen(&lt->es,eid)) new1 = 2; } // új él (itt nem kell az időpont)
+	else { //időpont frissítése
+		unsigned int* ts = edgestate_ts(&lt->es,eid);
+		unsigned int t2 = *ts;
+		*ts = timestamp;
+		if(M == PTG_LT_QUEUE) { // delay > 0, a sor végére kerül az él
+			if(t2 < time1) { //nem aktív ez az él
+				if(t2 == 0) new1 = 2; //még egyszer sem volt aktív
+				else new1 = 1; //korábban már aktív volt, de már deaktiváltuk
+			}
+			//ha ugyanezzel az időponttal már a sorban van, nem kell újra hozzáadni
+			if((new1 || t2 != timestamp) && lt->eq.add(eid)) return 1;
+		}
+		else { // delay > 0, a heap-et is frissíteni kell
+			if(t2 < time1) { //nem aktív ez az él
+				if(lt->eh.add(eid)) return 1; //hiba
+				if(t2 == 0) new1 = 2; //még egyszer sem volt aktív
+				else new1 = 1; //korábban már aktív volt, de már deaktiváltuk
+			}
+			else { //még aktív, az időpontot kell csak frissíteni
+				uint64_t off = edgestate_get_off(&lt->es,eid);
+				lt->eh.heapdown(off); //csak lefelé mehet, az új timestamp nagyobb
+			}
+		}
+	}
+	
+	if(new_node) {
+		/* new in node */
+		if(new1 != 2) {
+			fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
+			return 1;
+		}
+		type = 3;
+	}
+	else switch(new1) {
+		case 0:
+			type = 4;
+			break;
+		case 1:
+			type = 5;
+			break;
+		case 2:
+			type = 2;
+			break;
+	}
+	int contract = 0;
+	if(C) {
+		if(ids_contract(il,idout)) contract += 1;
+		if(ids_contract(il,idin)) contract += 2;
+	}
+	ptg_event(lt,type,indeg,timestamp,contract,C);
+	
+	if(new1) { //inaktív él, fokszámok frissítése
+		ptg_event(lt,1,indeg,timestamp,C ? (int)ids_contract(il,idout) : 0,C);
+		lt->inlinks.inc(idout);
+		*activated = 1;
+	}
+	return 0;
+}
+
+
+/* estimates of the memory used (for -m): the edges and the lookup structures
+ * (the hash index is counted if it will be created), and the IDs with the state
+ * of the nodes and the edges for all lifetimes (the expiry heap is counted as
+ * if it contained all edges, and the expiry queue with the largest size it can
+ * grow to, see edgequeue.h, so this is an upper estimate) */
+static uint64_t ptg_mem_edges(const edges* ee, int edgeindex) {
+	uint64_t x = ee->nedges*sizeof(edge);
+	if(ee->h) x += ee->h->size;
+	if(ee->hi) x += ee->hi->width*(ee->hi->mask + 1);
+	else if(edgeindex) {
+		uint64_t size = 1024;
+		while(size < ee->nedges + ee->nedges/3) size *= 2; /* see edges_createindex() */
+		x += size*edgeidx_width(ee->nedges);
+	}
+	return x;
+}
+static uint64_t ptg_mem_state(const idlist* il, const edges* ee, const std::vector<unsigned int>& delays, int use_heap,
+		unsigned int nthreads) {
+	uint64_t m = ee->nedges;
+	uint64_t w = edgeidx_width(m);
+	uint64_t x = il->N*sizeof(nodeid) + 2*ids_bitset_size(il->N);
+	for(unsigned int d : delays) {
+		x += il->N*sizeof(uint16_t) + NODEDEG_SLOTS*(sizeof(unsigned int) + sizeof(nodeid)); /* in-degrees (see nodedeg.h) */
+		if(d == 0) x += (m/64 + 1)*sizeof(uint64_t);
+		else if(use_heap) x += m*(sizeof(unsigned int) + w + sizeof(uint64_t)); /* ts, off, heap */
+		else if(nthreads > 1) /* ts, queues of the workers (each one at most max_size() of its edges, with sequence numbers) */
+			x += m*sizeof(unsigned int) + (4*m + nthreads*edgequeue::max_size(0))*(w + sizeof(uint32_t) + sizeof(uint64_t));
+		else x += m*sizeof(unsigned int) + edgequeue::max_size(m)*(w + sizeof(uint32_t)); /* ts, queue */
+	}
+	return x;
+}
+
+
+/* batched lookups: the node indices and the edge of each transaction only
+ * depend on the (read-only) lists of IDs and edges, so these are looked up
+ * for a batch of transactions first, in stages; in each stage, the memory
+ * needed by the next stage is prefetched for all transactions of the batch,
+ * so that the cache misses of different transactions overlap instead of
+ * being paid one after the other; the state of the edges and nodes is
+ * updated afterwards, in the original order */
+#define PTG_BATCH 64
+
+typedef struct ptg_lookup_t {
+	erecord rec;
+	nodeid idin;
+	nodeid idout;
+	uint64_t eid; /* ee->nedges if not found or not needed (rec.in == rec.out) */
+} ptg_lookup;
+
+template<int M>
+static void ptg_lookup_batch(ptg_lookup* b, size_t n, const idlist* il, edges* ee, const ptg_lifetime* lts, size_t nlt) {
+	for(size_t j=0;j<n;j++) {
+		ids_prefetch(il,b[j].rec.in);
+		ids_prefetch(il,b[j].rec.out);
+	}
+	for(size_t j=0;j<n;j++) {
+		b[j].idin = ids_find2(il,b[j].rec.in);
+		b[j].idout = ids_find2(il,b[j].rec.out);
+		b[j].eid = ee->nedges;
+		if(b[j].idin < il->N && b[j].idout < il->N && b[j].rec.in != b[j].rec.out) {
+			if(ee->dense) edges_find_prefetch(ee,b[j].idin,b[j].idout,0);
+			else edges_find_prefetch(ee,b[j].rec.in,b[j].rec.out,0);
+		}
+	}
+	for(size_t j=0;j<n;j++) if(b[j].idin < il->N && b[j].idout < il->N && b[j].rec.in != b[j].rec.out) {
+		if(ee->dense) edges_find_prefetch(ee,b[j].idin,b[j].idout,1);
+		else edges_find_prefetch(ee,b[j].rec.in,b[j].rec.out,1);
+	}
+	for(size_t j=0;j<n;j++) if(b[j].idin < il->N && b[j].idout < il->N && b[j].rec.in != b[j].rec.out) {
+		uint64_t eid = ee->dense ? edges_find(ee,b[j].idin,b[j].idout) : edges_find(ee,b[j].rec.in,b[j].rec.out);
+		b[j].eid = eid;
+		if(eid >= ee->nedges) continue;
+		/* state used by ptg_process() */
+		__builtin_prefetch(il->sent + (b[j].idin >> 6), 1);
+		for(size_t k=0;k<nlt;k++) {
+			const ptg_lifetime* lt = lts + k;
+			int m = (M == PTG_LT_MIXED) ? ptg_lt_mode(lt) : M;
+			lt->inlinks.prefetch(b[j].idout);
+			if(m == PTG_LT_SEEN) __builtin_prefetch(lt->es.seen + (eid >> 6), 1);
+			else {
+				__builtin_prefetch(lt->es.ts + eid, 1);
+				if(m == PTG_LT_HEAP) __builtin_prefetch(lt->es.off + lt->es.off_width*eid);
+			}
+		}
+	}
+}
+
+
+/* input of the serial processing (the Src parameter of ptg_run()): read()
+ * reads the next transaction, returns nonzero at the end of the input or on
+ * an error; pos() is the position saved in checkpoints */
+struct ptg_src_text {
+	read_table* rt;
+	int ignore_invalid;
+	int read(erecord* e) { return erecord_read(rt,e,ignore_invalid); }
+	uint64_t pos() const { return rt->line; }
+};
+struct ptg_src_raw { /* -b, raw 12-byte records */
+	erecord_bin* eb;
+	int read(erecord* e) { return erecord_bin_read_raw(eb,e); }
+	uint64_t pos() const { return eb->ix; }
+};
+struct ptg_src_packed { /* -b, EVBIN_TX records */
+	erecord_bin* eb;
+	int read(erecord* e) { return erecord_bin_read_packed(eb,e); }
+	uint64_t pos() const { return eb->ix; }
+};
+
+/* state of the serial processing, shared with main() */
+typedef struct ptg_loop_t {
+	ptg_lifetime* lts;
+	size_t nlt;
+	idlist* il;
+	edges* ee;
+	uint64_t nedges2; /* number of transactions processed */
+	uint64_t DE1; /* print the progress after this many transactions (0: never) */
+	uint64_t DENEXT;
+	const char* fckpt; /* checkpoints are only created if not NULL (-P) */
+	ckpt* ck;
+	ptg_ckpt_header* ck_hdr;
+	unsigned int ckpt_interval;
+	time_t ck_next;
+} ptg_loop;
+
+/* process all transactions without -T: the first one is given in edge1, the
+ * rest are read from src; instantiated for each input format (Src), mode of
+ * the lifetimes (M, PTG_LT_MIXED if they use different modes) and with or
+ * without contracts (C); returns 0 on success, 1 on an error while processing
+ * (errors while reading the input are checked by the caller) */
+template<class Src, int M, int C>
+static int ptg_run(ptg_loop* L, Src& src, const erecord& edge1) {
+	ptg_lifetime* lts = L->lts;
+	const size_t nlt = L->nlt;
+	idlist* il = L->il;
+	edges* ee = L->ee;
+	uint64_t nedges2 = L->nedges2;
+	uint64_t DENEXT = L->DE1 ? L->DENEXT : UINT64_MAX; /* only one comparison for each transaction */
+	uint64_t ck_cnt = 0;
+	int r = 0;
+	int proc_err = 0;
+	
+	/* transactions are read in batches, see ptg_lookup_batch() */
+	ptg_lookup batch[PTG_BATCH];
+	size_t nb = 1;
+	batch[0].rec = edge1;
+	do {
+		//új tranzakciók beolvasása
+		for(; nb < PTG_BATCH; nb++) {
+			r = src.read(&batch[nb].rec);
+			if(r) break;
+		}
+		ptg_lookup_batch<M>(batch, nb, il, ee, lts, nlt);
+		
+		for(size_t j=0;j<nb;j++) {
+			const ptg_lookup& x = batch[j];
+			//új rekord az x változóban, ezt kell feldolgozni, ehhez az rin és rout változókon kell iterálni, amíg el nem érjük a tranzakció időpontját
+			unsigned int timestamp = x.rec.timestamp;
+			
+			//régi élek törlése
+			if(M != PTG_LT_SEEN) for(size_t k=0;k<nlt;k++) {
+				ptg_lifetime* lt = lts + k;
+				int m = (M == PTG_LT_MIXED) ? ptg_lt_mode(lt) : M;
+				if(m == PTG_LT_SEEN) continue;
+				unsigned int time1 = 0;
+				if(timestamp > lt->delay) time1 = timestamp - lt->delay;
+				if(m == PTG_LT_HEAP) proc_err = ptg_expire<PTG_LT_HEAP,C>(lt, il, ee, time1);
+				else proc_err = ptg_expire<PTG_LT_QUEUE,C>(lt, il, ee, time1);
+				if(proc_err) break;
+			}
+			if(proc_err) break;
+			
+			//feldolgoztuk a be- és kimenő összegeket, most vethetjük össze a statisztikákkal
+			nodeid idin = x.idin;
+			nodeid idout = x.idout;
+			
+			if(idin >= il->N || idout >= il->N) { //ez itt nem fordulhat elő, az összes ID-nek szerepelnie kell a felsorolásban
+				fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
+				proc_err = 1;
+				break;
+			}
+			
+			if(x.rec.in != x.rec.out) { //érvényes tranzakciót olvastunk be
+				//a "cél" címmel foglalkozunk
+				uint64_t eid = x.eid; //feltesszük, hogy ez az él még nem szerepelt
+				if(eid >= ee->nedges) {
+					fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
+					proc_err = 1;
+					break;
+				}
+				
+				nedges2++;
+				
+				/* note: sent is shared among the lifetimes, it is only used to
+				 * determine if the sender is new, which does not depend on the lifetime */
+				int new_node = !ids_sent(il,idin);
+				int activated = 0;
+				for(size_t k=0;k<nlt;k++) {
+					ptg_lifetime* lt = lts + k;
+					switch((M == PTG_LT_MIXED) ? ptg_lt_mode(lt) : M) {
+						case PTG_LT_SEEN:
+							proc_err = ptg_process<PTG_LT_SEEN,C>(lt, il, eid, idin, idout, timestamp, new_node, &activated);
+							break;
+						case PTG_LT_QUEUE:
+							proc_err = ptg_process<PTG_LT_QUEUE,C>(lt, il, eid, idin, idout, timestamp, new_node, &activated);
+							break;
+						default:
+							proc_err = ptg_process<PTG_LT_HEAP,C>(lt, il, eid, idin, idout, timestamp, new_node, &activated);
+							break;
+					}
+					if(proc_err) break;
+				}
+				if(proc_err) break;
+				if(activated) ids_set_sent(il,idin);
+			}
+			
+			if(nedges2 >= DENEXT) {
+				fprintf(stderr,"%lu él feldolgozva\n",nedges2);
+				DENEXT = nedges2 + L->DE1;
+			}
+		}
+		if(proc_err) break;
+		
+		/* checkpoint (only between batches, when all transactions read are
+		 * processed): the time is only checked occasionally; if the previous
+		 * checkpoint is still being written, the next one is delayed */
+		ck_cnt += nb;
+		if(L->fckpt && ck_cnt >= 65536) {
+			ck_cnt = 0;
+			if(time(0) >= L->ck_next && ckpt_wait(L->ck,0) >= 0) {
+				L->ck_hdr->pos = src.pos();
+				L->ck_hdr->nedges2 = nedges2;
+				L->ck_hdr->DENEXT = L->DE1 ? DENEXT : L->DENEXT;
+				if(ptg_checkpoint(L->ck,L->ck_hdr,lts,nlt,il)) fprintf(stderr,"Error creating checkpoint!\n");
+				L->ck_next = time(0) + L->ckpt_interval;
+			}
+		}
+		nb = 0;
+	} while(r == 0);
+	
+	L->nedges2 = nedges2;
+	if(L->DE1) L->DENEXT = DENEXT;
+	return proc_err;
+}
+
+/* choose the instance of ptg_run() for the modes of the lifetimes and contracts */
+template<class Src>
+static int ptg_run_mode(ptg_loop* L, Src& src, const erecord& edge1, int have_contracts) {
+	int mode = ptg_lt_mode(L->lts);
+	for(size_t k=1;k<L->nlt;k++) if(ptg_lt_mode(L->lts + k) != mode) mode = PTG_LT_MIXED;
+	switch(mode) {
+		case PTG_LT_SEEN:
+			return have_contracts ? ptg_run<Src,PTG_LT_SEEN,1>(L,src,edge1) : ptg_run<Src,PTG_LT_SEEN,0>(L,src,edge1);
+		case PTG_LT_QUEUE:
+			return have_contracts ? ptg_run<Src,PTG_LT_QUEUE,1>(L,src,edge1) : ptg_run<Src,PTG_LT_QUEUE,0>(L,src,edge1);
+		case PTG_LT_HEAP:
+			return have_contracts ? ptg_run<Src,PTG_LT_HEAP,1>(L,src,edge1) : ptg_run<Src,PTG_LT_HEAP,0>(L,src,edge1);
+		default:
+			return have_contracts ? ptg_run<Src,PTG_LT_MIXED,1>(L,src,edge1) : ptg_run<Src,PTG_LT_MIXED,0>(L,src,edge1);
+	}
+}
+
+
+/* parallel event generation (-T): transactions are read in batches, and
+ * assigned to worker threads by their target node; each worker only changes
+ * the state of its own nodes and edges (inlinks, edge timestamps) and has its
+ * own expiry queue; the events created by the workers are merged in the main
+ * thread in the same order as the serial version writes them:
+ * 	- events of the transactions are in the order of the input
+ * 	- an expired edge is written before the first transaction that is more
+ * 	  than the lifetime later than the edge's last activity, these are in the
+ * 	  order the edges were added to the queues (by the index of the transaction)
+ * 	- whether the sender is new (type 3) depends on transactions handled by
+ * 	  other workers, this is decided during the merge (using il->sent)
+ * with -E, the order of edges expiring at the same time depends on the heap,
+ * so this can only be used with the expiry queue */
+
+/* one event (or the events of one transaction) created by a worker */
+typedef struct ptg_pev_t {
+	uint64_t seq; /* expiry: index of the transaction that added the edge to the queue; transaction: idin */
+	uint32_t ts; /* expiry: last activity of the edge */
+	uint32_t deg;
+	nodeid node; /* expiry: target of the edge (for -K) */
+	uint8_t type;
+	uint8_t flags; /* PTG_PEV_... */
+	uint8_t contract;
+	uint8_t contract1; /* for the type 1 event */
+} ptg_pev;
+
+#define PTG_PEV_TX 1 /* event of a transaction (otherwise an expired edge) */
+#define PTG_PEV_ACT 2 /* the edge became active in this lifetime (a type 1 event follows) */
+#define PTG_PEV_ACT_ANY 4 /* the edge became active in any of the lifetimes */
+
+class ptg_par {
+	public:
+		static constexpr size_t batch_size = 65536;
+		
+		ptg_par(ptg_lifetime* lts1, size_t nlt1, idlist* il1, edges* ee1, unsigned int nthreads1, int have_contracts1) :
+			lts(lts1), nlt(nlt1), il(il1), ee(ee1), nthreads(nthreads1), have_contracts(have_contracts1) { }
+		~ptg_par() {
+			{
+				std::unique_lock<std::mutex> lock(m);
+				stop = true;
+				cv.notify_all();
+			}
+			for(std::thread& t : threads) t.join();
+			for(edgequeue* eq : queues) delete[] eq;
+		}
+		ptg_par(const ptg_par&) = delete;
+		ptg_par& operator = (const ptg_par&) = delete;
+		
+		/* allocate the state of the workers and start the threads */
+		void start() {
+			for(unsigned int w=0;w<nthreads;w++) {
+				edgequeue* eq = new edgequeue[nlt];
+				for(size_t k=0;k<nlt;k++) {
+					eq[k].s = lts[k].es;
+					eq[k].track_seq = 1;
+				}
+				queues.push_back(eq);
+			}
+			for(batch& b : bufs) {
+				b.idx.resize(nthreads);
+				b.out.resize(nthreads);
+				for(auto& x : b.out) x.resize(nlt);
+			}
+			heads.resize(nthreads*nlt);
+			for(unsigned int w=0;w<nthreads;w++) threads.emplace_back([this,w]() { run_worker(w); });
+		}
+		
+		/* process all transactions: the first one is given in edge1, the rest are
+		 * read with read_next(erecord*), which should return 0 on success;
+		 * returns 0 on success, 1 on error */
+		template<class F> int run(const erecord& edge1, F&& read_next, uint64_t& nedges2, uint64_t DE1, uint64_t& DENEXT) {
+			batch* prev = 0;
+			bool eof = false;
+			uint64_t seq = 0;
+			for(int cur = 0;;cur ^= 1) {
+				batch* b = bufs + cur;
+				b->start = seq;
+				b->rec.clear();
+				if(!seq) b->rec.push_back(edge1);
+				while(!eof && b->rec.size() < batch_size) {
+					erecord x;
+					if(read_next(&x)) eof = true;
+					else b->rec.push_back(x);
+				}
+				seq += b->rec.size();
+				if(prev && wait_workers()) return 1;
+				if(!b->rec.empty()) start_workers(b);
+				if(prev && merge(prev,nedges2,DE1,DENEXT)) {
+					if(!b->rec.empty()) wait_workers();
+					return 1;
+				}
+				if(b->rec.empty()) break;
+				prev = b;
+			}
+			return 0;
+		}
+		
+	protected:
+		struct batch {
+			std::vector<erecord> rec;
+			uint64_t start; /* index of the first transaction */
+			std::vector<std::vector<uint32_t> > idx; /* transactions assigned to each worker */
+			std::vector<std::vector<std::vector<ptg_pev> > > out; /* events created by each worker for each lifetime */
+		};
+		
+		ptg_lifetime* lts;
+		size_t nlt;
+		idlist* il;
+		edges* ee;
+		unsigned int nthreads;
+		int have_contracts;
+		std::vector<edgequeue*> queues; /* expiry queues of the workers (one for each lifetime) */
+		std::vector<std::thread> threads;
+		batch bufs[2]; /* the next batch is read and processed while the previous one is merged */
+		std::vector<size_t> heads; /* merge: position in the events of each worker and lifetime */
+		
+		std::mutex m;
+		std::condition_variable cv;
+		std::condition_variable cv_done;
+		batch* cur_batch = 0;
+		uint64_t gen = 0; /* incremented for each new batch */
+		unsigned int running = 0; /* number of workers still processing the current batch */
+		bool stop = false;
+		bool error = false;
+		
+		/* worker thread assigned to a transaction, by its target node */
+		unsigned int worker(const erecord& x) const {
+			return (unsigned int)(((edgeindex_hash(x.out) >> 32) * nthreads) >> 32);
+		}
+		
+		void start_workers(batch* b) {
+			for(auto& x : b->idx) x.clear();
+			for(size_t i=0;i<b->rec.size();i++) b->idx[worker(b->rec[i])].push_back(i);
+			std::unique_lock<std::mutex> lock(m);
+			cur_batch = b;
+			running = nthreads;
+			gen++;
+			cv.notify_all();
+		}
+		int wait_workers() {
+			std::unique_lock<std::mutex> lock(m);
+			cv_done.wait(lock, [this]() { return running == 0; });
+			return error ? 1 : 0;
+		}
+		
+		void run_worker(unsigned int w) {
+			uint64_t gen1 = 0;
+			while(true) {
+				batch* b;
+				{
+					std::unique_lock<std::mutex> lock(m);
+					cv.wait(lock, [this,gen1]() { return stop || gen != gen1; });
+					if(stop) return;
+					gen1 = gen;
+					b = cur_batch;
+				}
+				int r = process(w,b);
+				std::unique_lock<std::mutex> lock(m);
+				if(r) error = true;
+				if(--running == 0) cv_done.notify_all();
+			}
+		}
+		
+		/* delete the edges of worker w that were last active before time1 in each lifetime */
+		int expire(unsigned int w, unsigned int timestamp, std::vector<ptg_pev>* out) {
+			for(size_t k=0;k<nlt;k++) if(lts[k].delay > 0) {
+				ptg_lifetime* lt = lts + k;
+				unsigned int time1 = 0;
+				if(timestamp > lt->delay) time1 = timestamp - lt->delay;
+				uint64_t n, seq;
+				unsigned int ts1;
+				while(queues[w][k].pop(time1,&n,&ts1,&seq)) {
+					nodeid idout;
+					edges_nodes(ee,il,n,0,&idout);
+					if(idout >= il->N || lt->inlinks.get(idout) == 0) {
+						fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
+						return 1;
+					}
+					ptg_pev p;
+					p.seq = seq;
+					p.ts = ts1;
+					p.deg = lt->inlinks.get(idout);
+					p.node = idout;
+					p.type = 0;
+					p.flags = 0;
+					p.contract = have_contracts ? ids_contract(il,idout) : 0;
+					p.contract1 = 0;
+					out[k].push_back(p);
+					lt->inlinks.dec(idout);
+				}
+			}
+			return 0;
+		}
+		
+		/* process the transactions of batch b assigned to worker w; the same as
+		 * ptg_process(), but the type is determined as if the sender was not new */
+		int process(unsigned int w, batch* b) {
+			std::vector<ptg_pev>* out = b->out[w].data();
+			for(size_t k=0;k<nlt;k++) out[k].clear();
+			for(uint32_t i : b->idx[w]) {
+				const erecord& x = b->rec[i];
+				unsigned int timestamp = x.timestamp;
+				if(expire(w,timestamp,out)) return 1;
+				nodeid idin = ids_find2(il,x.in);
+				nodeid idout = ids_find2(il,x.out);
+				if(idin >= il->N || idout >= il->N) {
+					fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
+					return 1;
+				}
+				if(x.in == x.out) continue;
+				uint64_t eid = ee->dense ? edges_find(ee,idin,idout) : edges_find(ee,x.in,x.out);
+				if(eid >= ee->nedges) {
+					fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
+					return 1;
+				}
+				uint8_t act_any = 0;
+				for(size_t k=0;k<nlt;k++) {
+					ptg_lifetime* lt = lts + k;
+					int new1 = 0;
+					unsigned int time1 = 0;
+					if(lt->delay > 0 && timestamp > lt->delay) time1 = timestamp - lt->delay;
+					if(lt->delay == 0) { if(!edgestate_seen_atomic(&lt->es,eid)) new1 = 2; }
+					else {
+						unsigned int* ts = edgestate_ts(&lt->es,eid);
+						unsigned int t2 = *ts;
+						*ts = timestamp;
+						if(t2 < time1) new1 = (t2 == 0) ? 2 : 1;
+						if((new1 || t2 != timestamp) && queues[w][k].add(eid,b->start + i)) return 1;
+					}
+					ptg_pev p;
+					p.seq = idin;
+					p.ts = timestamp;
+					p.deg = lt->inlinks.get(idout);
+					p.node = idout;
+					p.type = (new1 == 0) ? 4 : ((new1 == 1) ? 5 : 2);
+					p.flags = PTG_PEV_TX | (new1 ? PTG_PEV_ACT : 0);
+					p.contract = 0;
+					p.contract1 = 0;
+					if(have_contracts) {
+						if(ids_contract(il,idout)) p.contract += 1;
+						if(ids_contract(il,idin)) p.contract += 2;
+						p.contract1 = ids_contract(il,idout);
+					}
+					out[k].push_back(p);
+					if(new1) {
+						lt->inlinks.inc(idout);
+						act_any = PTG_PEV_ACT_ANY;
+					}
+				}
+				if(act_any) for(size_t k=0;k<nlt;k++) out[k].back().flags |= act_any;
+			}
+			if(!b->rec.empty()) return expire(w,b->rec.back().timestamp,out);
+			return 0;
+		}
+		
+		/* write out the events of batch b in order */
+		int merge(batch* b, uint64_t& nedges2, uint64_t DE1, uint64_t& DENEXT) {
+			/* expired edges that can be written next, ordered by (timestamp, index of transaction) */
+			typedef std::pair<std::pair<uint32_t,uint64_t>,unsigned int> hitem;
+			std::vector<std::priority_queue<hitem,std::vector<hitem>,std::greater<hitem> > > heap(nlt);
+			auto next = [&](unsigned int w, size_t k) {
+				const std::vector<ptg_pev>& out = b->out[w][k];
+				size_t i = heads[w*nlt + k];
+				if(i < out.size() && !(out[i].flags & PTG_PEV_TX)) heap[k].push(hitem(std::make_pair(out[i].ts,out[i].seq),w));
+			};
+			for(unsigned int w=0;w<nthreads;w++) for(size_t k=0;k<nlt;k++) {
+				heads[w*nlt + k] = 0;
+				next(w,k);
+			}
+			
+			for(const erecord& x : b->rec) {
+				unsigned int timestamp = x.timestamp;
+				for(size_t k=0;k<nlt;k++) if(lts[k].delay > 0) {
+					ptg_lifetime* lt = lts + k;
+					unsigned int time1 = 0;
+					if(timestamp > lt->delay) time1 = timestamp - lt->delay;
+					while(!heap[k].empty() && heap[k].top().first.first < time1) {
+						unsigned int w = heap[k].top().second;
+						heap[k].pop();
+						const ptg_pev& p = b->out[w][k][heads[w*nlt + k]++];
+						ptg_degdec(lt,p.node,p.deg,p.ts + lt->delay,p.contract,have_contracts);
+						next(w,k);
+					}
+					if(!lt->dd.empty()) ptg_degdec_flush(lt,have_contracts);
+				}
+				if(x.in == x.out) continue;
+				
+				unsigned int w = worker(x);
+				size_t i = heads[w*nlt];
+				if(i >= b->out[w][0].size() || !(b->out[w][0][i].flags & PTG_PEV_TX)) {
+					fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
+					return 1;
+				}
+				nodeid idin = (nodeid)b->out[w][0][i].seq;
+				int new_node = !ids_sent(il,idin);
+				int act_any = 0;
+				for(size_t k=0;k<nlt;k++) {
+					size_t& j = heads[w*nlt + k];
+					if(j >= b->out[w][k].size() || !(b->out[w][k][j].flags & PTG_PEV_TX)) {
+						fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
+						return 1;
+					}
+					const ptg_pev& p = b->out[w][k][j++];
+					unsigned int type = p.type;
+					if(new_node) {
+						if(type != 2) {
+							fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
+							return 1;
+						}
+						type = 3;
+					}
+					ptg_event(lts + k,type,p.deg,timestamp,p.contract,have_contracts);
+					if(p.flags & PTG_PEV_ACT) ptg_event(lts + k,1,p.deg,timestamp,p.contract1,have_contracts);
+					if(p.flags & PTG_PEV_ACT_ANY) act_any = 1;
+					next(w,k);
+				}
+				if(act_any) ids_set_sent(il,idin);
+				
+				nedges2++;
+				if(DE1) if(nedges2 >= DENEXT) {
+					fprintf(stderr,"%lu él feldolgozva\n",nedges2);
+					DENEXT = nedges2 + DE1;
+				}
+			}
+			return 0;
+		}
+};
+
+
 int main(int argc, char **argv)
 {
 	/*
@@ -202,29 +1591,61 @@ int main(int argc, char **argv)
 	 * 	1. ids -- címek / felhasználók listája
 	 * 	2. txedge -- összes első tranzakció, idő szerint rendezve (címek és időpont)
 	 */
-	unsigned int N = 0; //id-k száma
+	uint64_t N = 0; //id-k száma
 	char* fids = 0;
 	char* ftxedge = 0;
 	char* flinks = 0;
+	char* fout = 0; /* base name of output files (required if more than one lifetime is given) */
 	int ignore_invalid = 1; /* ignore "invalid" node IDs that cause overflow / underflow (-1 for unknown addresses typically) */
 	int edges_bin = 0; // read edges from binary file
 	int have_contracts = 0; // include contracts (for Ethereum)
+	int out_zip = 1; /* compress output files (if written to files) */
+	int out_bin = 0; /* write output in binary format (evbin.h) */
+	int dense_ids = 0; /* replace node IDs in the edges by their index in il (ids_replace()) */
+	int use_heap = 0; /* use a binary heap for edge expiry (-E) instead of the queue in edgequeue.h */
+	int compact = 0; /* coalesce the degree decreases of expired edges (-K) */
+	unsigned int read_threads = 0; /* number of threads used for parsing the ID and edge lists (0: all CPUs) */
+	const char* fcache = 0; /* cache file for the processed IDs and edges (-C, see idcache.h) */
+	int cached = 0; /* IDs and edges were loaded from the cache file */
+	idcache_src cache_src;
+	const char* fckpt = 0; /* checkpoint file (-P, see checkpoint.h) */
+	unsigned int ckpt_interval = 3600; /* time between checkpoints (seconds) */
+	int resume = 0; /* continue from the checkpoint (--resume) */
+	int mem_policy = 0; /* placement of the large arrays (-M, see memplace.h) */
+	uint64_t mem_budget = UINT64_MAX; /* compress the edges if the memory use would be more than this (-m) */
+	ckpt ck = {0, 0, 0};
+	ptg_ckpt_header ck_hdr;
+	time_t ck_next = 0;
+	std::vector<ptg_resume_lt> res;
+	unsigned int par_threads = 0; /* number of threads for processing the transactions (-T, see ptg_par) */
+	int par_err = 0;
+	int proc_err = 0; /* error while processing the transactions */
 	
 	erecord edge1;
 	idlist* il = 0;
-	erecord_bin eb = {NULL, 0, 0, -1};
+	erecord_bin eb;
+	eb.e = NULL;
+	eb.fd = -1;
+	eb.packed = 0;
+	eb.error = 0;
+	eb.ignore_invalid = 0;
 	
-	unsigned int delay = 2592000; //linkek élettartama (30 nap)
+	/* linkek élettartama (alapértelmezés: 30 nap); több is megadható, ezeket egyszerre dolgozzuk fel */
+	std::vector<unsigned int> delays;
+	std::vector<const char*> delay_strs;
+	std::vector<ptg_ranks*> ranks; /* rank calculations done directly (-R) */
+	std::vector<const char*> ranks_args;
+	ptg_lifetime* lts = 0;
+	size_t nlt = 0;
 	edges* ee = 0;
-	edgeheap eh;
 	unsigned int nedges = 0; //élek száma
 	uint64_t DE1 = 100000; //ennyi él feldolgozása után kiírás
 	
 	time_t t1 = time(0);
 	time_t t2 = 0;
 	time_t t3 = 0;
-	int zip = 0; //bemeneti fájlok tömörítve
 	int edgehelper = 0;
+	int edgeindex = 0; /* use a hash table for edge lookups */
 
 	uint64_t nedges2 = 0; //feldolgozott tranzakciók száma (többszörös élek többször)
 	
@@ -253,19 +1674,47 @@ int main(int argc, char **argv)
 				break;
 			case 'N':
 			case 'n':
-				N = atoi(argv[i+1]);
+				N = strtoull(argv[i+1],0,10);
 				i++;
 				break;
 			case 'd':
-				if(strtodint(argv[i+1],&delay)) fprintf(stderr,"Érvénytelen paraméter: %s %s!\n",argv[i],argv[i+1]);
+				/* one or more lifetimes, e.g. -d 0 30d 1d */
+				for( ; i+1 < argc && isdigit(argv[i+1][0]); i++) {
+					unsigned int delay;
+					if(strtodint(argv[i+1],&delay)) { fprintf(stderr,"Érvénytelen paraméter: %s %s!\n",argv[i],argv[i+1]); break; }
+					/* the same lifetime given again (e.g. -d 1d 24h) is only processed once,
+					 * otherwise both would write the same output file */
+					size_t k;
+					for(k=0;k<delays.size();k++) if(delays[k] == delay) break;
+					if(k < delays.size()) continue;
+					delays.push_back(delay);
+					delay_strs.push_back(argv[i+1]);
+				}
+				break;
+			case 'o':
+				fout = argv[i+1];
 				i++;
 				break;
+			case 'z':
+				out_zip = 0;
+				break;
+			case 'B':
+				out_bin = 1;
+				break;
 			case 'Z':
-				zip = 1;
+				/* compressed input files are detected automatically (see zfile.h),
+				 * this option is kept for compatibility */
 				break;
 			case 'H':
 				edgehelper = 1;
 				break;
+			case 'C':
+				fcache = argv[i+1];
+				i++;
+				break;
+			case 'h':
+				edgeindex = 1;
+				break;
 			case 'I':
 				ignore_invalid = 0;
 				break;
@@ -275,6 +1724,50 @@ int main(int argc, char **argv)
 			case 'c':
 				have_contracts = 1;
 				break;
+			case 'X':
+				dense_ids = 1;
+				break;
+			case 'E':
+				use_heap = 1;
+				break;
+			case 'K':
+				compact = 1;
+				break;
+			case 'j':
+				read_threads = atoi(argv[i+1]);
+				i++;
+				break;
+			case 'T':
+				par_threads = atoi(argv[i+1]);
+				i++;
+				break;
+			case 'R':
+				if(i+1 < argc) ranks_args.push_back(argv[i+1]);
+				i++;
+				break;
+			case 'M':
+				if(memplace_parse(argv[i+1],&mem_policy)) fprintf(stderr,"Invalid parameter: %s %s!\n",argv[i],argv[i+1]);
+				i++;
+				break;
+			case 'm':
+				if(strtosize(argv[i+1],&mem_budget)) fprintf(stderr,"Invalid parameter: %s %s!\n",argv[i],argv[i+1]);
+				i++;
+				break;
+			case 'P':
+				/* checkpoint file, optionally followed by the interval (e.g. -P ptg.ckpt 2h) */
+				fckpt = argv[i+1];
+				i++;
+				if(i+1 < argc && isdigit(argv[i+1][0])) {
+					if(strtodint(argv[i+1],&ckpt_interval)) fprintf(stderr,"Invalid parameter: %s %s!\n",argv[i-1],argv[i+1]);
+					i++;
+				}
+				break;
+			case '-':
+				if(!strcmp(argv[i],"--resume")) {
+					resume = 1;
+					break;
+				}
+				/* fallthrough */
 			default:
 				fprintf(stderr,"Ismeretlen paraméter: %s!\n",argv[i]);
 				break;
@@ -286,50 +1779,80 @@ int main(int argc, char **argv)
 		fprintf(stderr,"Nincsenek bemeneti fájlok megadva!\n");
 		return 1;
 	}
-	
-	FILE* fi = 0;
-	FILE* e = 0;
-	FILE* links = 0;
-	FILE* test_out = stdout;
-	if(zip) {
-		size_t l1 = strlen(fids);
-		size_t l2 = strlen(flinks);
-		size_t l3 = strlen(ftxedge);
-		if(l2 > l1) l1 = l2;
-		if(l3 > l1) l1 = l3;
-		char* tmp = (char*)malloc(sizeof(char)*(l1 + strlen(zcat) + 4));
-		if(!tmp) {
-			fprintf(stderr,"Error allocating memory!\n");
+	if(delays.empty() && ranks_args.empty()) {
+		delays.push_back(2592000); //30 nap
+		delay_strs.push_back("30d");
+	}
+	for(const char* arg : ranks_args) {
+		/* lifetimes used for rank calculations are added to the list if not given with -d */
+		ptg_ranks* pr = new ptg_ranks;
+		pr->str = 0;
+		pr->calc = 0;
+		pr->err = 0;
+		ranks.push_back(pr);
+		unsigned int delay;
+		if(ptg_ranks_parse(pr,arg,&delay)) {
+			fprintf(stderr,"Invalid parameter: -R %s!\n",arg);
+			for(ptg_ranks* pr1 : ranks) ptg_ranks_free(pr1);
 			return 1;
 		}
-		sprintf(tmp,"%s %s",zcat,fids);
-		fi = popen(tmp,"r");
-		sprintf(tmp,"%s %s",zcat,flinks);
-		links = popen(tmp,"r");
-		if(!edges_bin) {
-			sprintf(tmp,"%s %s",zcat,ftxedge);
-			e = popen(tmp,"r");
+		for(pr->lt = 0; pr->lt < delays.size(); pr->lt++) if(delays[pr->lt] == delay) break;
+		if(pr->lt == delays.size()) {
+			delays.push_back(delay);
+			delay_strs.push_back(pr->args[0]);
 		}
-		free(tmp);
 	}
-	else {
-		fi = fopen(fids,"r");
-		links = fopen(flinks,"r");
-		if(!edges_bin) e = fopen(ftxedge,"r");
+	if(delays.size() > 1 && !fout && ranks.empty()) {
+		fprintf(stderr,"Output file name (-o) is required if more than one lifetime is given!\n");
+		return 1;
+	}
+	if(par_threads > 1 && (use_heap || fckpt)) {
+		fprintf(stderr,"Parallel processing (-T) cannot be used with -E or -P!\n");
+		for(ptg_ranks* pr : ranks) ptg_ranks_free(pr);
+		return 1;
+	}
+	if(resume && !fckpt) {
+		fprintf(stderr,"The checkpoint file (-P) is required for --resume!\n");
+		return 1;
+	}
+	if(fckpt && (!fout || !ranks.empty())) {
+		/* the output files are continued when resuming, the state of the rank calculations is not saved */
+		fprintf(stderr,"Checkpoints (-P) require output files (-o) and cannot be used with -R!\n");
+		for(ptg_ranks* pr : ranks) ptg_ranks_free(pr);
+		return 1;
 	}
 	
-	if( ! (fi && links && (e || edges_bin)) ) {
-		fprintf(stderr,"Error opening input files!\n");
-		if(zip) {
-			if(fi) pclose(fi);
-			if(e) pclose(e);
-			if(links) pclose(links);
-		}
-		else {
-			if(fi) fclose(fi);
-			if(e) fclose(e);
-			if(links) fclose(links);
+	/* has to be set before any of the large arrays are allocated */
+	if(mem_policy) memplace_set(mem_policy, read_threads);
+	
+	if(fcache) {
+		int cache_flags = (dense_ids ? IDCACHE_DENSE : 0) | (have_contracts ? IDCACHE_CONTRACTS : 0) |
+			(edgehelper ? IDCACHE_HELPER : 0);
+		if(idcache_checksum(&cache_src,fids,flinks)) {
+			fprintf(stderr,"Error opening input files!\n");
+			return 1;
 		}
+		r = idcache_load(fcache,&cache_src,cache_flags,&il,&ee);
+		if(r > 1) fprintf(stderr,"Cannot use the cache file %s, reading the input files instead!\n",fcache);
+		cached = (r == 0);
+		r = 0;
+	}
+	
+	/* compressed input files are decompressed in a separate thread (see zfile.h) */
+	FILE* fi = 0;
+	FILE* e = 0;
+	FILE* links = 0;
+	if(!cached) {
+		fi = zfile_open(fids, read_threads);
+		links = zfile_open(flinks, read_threads);
+	}
+	if(!edges_bin) e = zfile_open(ftxedge, read_threads);
+	
+	if( ! ((cached || (fi && links)) && (e || edges_bin)) ) {
+		fprintf(stderr,"Error opening input files!\n");
+		if(fi) fclose(fi);
+		if(e) fclose(e);
+		if(links) fclose(links);
 		return 1;
 	}
 	read_table* e_rt = NULL;
@@ -340,191 +1863,207 @@ int main(int argc, char **argv)
 	else {
 		if(erecord_bin_open(&eb, ftxedge)) {
 			fprintf(stderr,"Error opening input files!\n");
-			if(zip) {
-				if(fi) pclose(fi);
-				if(links) pclose(links);
+			if(fi) fclose(fi);
+			if(links) fclose(links);
+			return 1;
+		}
+		eb.ignore_invalid = ignore_invalid;
+	}
+	
+	if(!cached) {
+		il = ids_read(fi, N, have_contracts, read_threads);
+		fclose(fi);
+		if(!il) {
+			fprintf(stderr,"Nem sikerült azonosítókat beolvasni a(z) %s fájlból!\n",fids);
+			fclose(links);
+			r = 3;
+			goto pt6_end;
+		}
+		
+		ee = edges_read(links, read_threads);
+		fclose(links);
+		if(!ee) {
+			fprintf(stderr,"Nem sikerült az éleket beolvasni a(z) %s fájlból!\n",flinks);
+			r = 2;
+			goto pt6_end;
+		}
+		if(dense_ids) {
+			/* this is done only once, lookups for expired edges do not need to search for the IDs later */
+			if(ids_replace(il,ee->e,ee->nedges)) {
+				fprintf(stderr,"Inconsistent node IDs in %s and %s!\n",flinks,fids);
+				r = 2;
+				goto pt6_end;
 			}
+			ee->dense = 1;
+		}
+		if(edgehelper) edges_createhelper(ee,il);
+		if(fcache && idcache_write(fcache,&cache_src,il,ee))
+			fprintf(stderr,"Error writing the cache file %s!\n",fcache);
+	}
+	N = il->N;
+	if(mem_budget != UINT64_MAX) {
+		uint64_t ebytes = ptg_mem_edges(ee,edgeindex);
+		uint64_t total = ptg_mem_state(il,ee,delays,use_heap,par_threads) + ebytes;
+		if(total > mem_budget) {
+			uint64_t cbytes = edgeef_size(ee->nedges,il->N);
+			if(edges_compress(ee,il)) fprintf(stderr,"Cannot use the compressed edge index!\n");
 			else {
-				if(fi) fclose(fi);
-				if(links) fclose(links);
+				fprintf(stderr,"Using the compressed edge index (%lu MiB instead of %lu MiB)\n",cbytes >> 20,ebytes >> 20);
+				edgeindex = 0;
+				total = total - ebytes + cbytes;
 			}
-			return 1;
+			if(mem_budget && total > mem_budget) fprintf(stderr,"Warning: the estimated memory use (%lu MiB) is above the budget given (-m)!\n",total >> 20);
 		}
 	}
+	if(edgeindex && edges_createindex(ee)) {
+		fprintf(stderr,"Error creating hash index for the edges!\n");
+		r = 2;
+		goto pt6_end;
+	}
 	
-	/* count the different types of output */
-	size_t ntypes[6] = {0,0,0,0,0,0};
+	/* state for each lifetime */
+	nlt = delays.size();
+	lts = new ptg_lifetime[nlt];
+	for(size_t k=0;k<nlt;k++) {
+		ptg_lifetime* lt = lts + k;
+		lt->delay = delays[k];
+		lt->delay_str = delay_strs[k];
+		lt->out = 0;
+		lt->zo = 0;
+		lt->evb = 0;
+		lt->compact = compact;
+		lt->dd_ts = 0;
+		for(i=0;i<7;i++) lt->ntypes[i] = 0;
+		/* only the state needed in this mode is allocated (see edgestate in edges.h) */
+		int esflags = EDGESTATE_SEEN;
+		if(lt->delay > 0) esflags = use_heap ? (EDGESTATE_TS | EDGESTATE_OFF) : EDGESTATE_TS;
+		if(lt->inlinks.init(N) || edgestate_init(&lt->es,ee,esflags)) {
+			fprintf(stderr,"Error allocating memory!\n");
+			nlt = k;
+			r = 1;
+			goto pt6_end;
+		}
+		lt->eh.s = lt->es;
+		lt->eq.s = lt->es;
+		lt->use_heap = use_heap;
+	}
 	
-	il = ids_read(fi, N, have_contracts);
-	if(zip) pclose(fi);
-	else fclose(fi);
-	if(!il) {
-		fprintf(stderr,"Nem sikerült azonosítókat beolvasni a(z) %s fájlból!\n",fids);
-		if(zip) pclose(links);
-		else fclose(links);
-		r = 3;
-		goto pt6_end;
+	/* checkpoints: parameters that should match when resuming */
+	if(fckpt) {
+		const char* fn[3] = {ftxedge, fids, flinks};
+		uint32_t flags = (use_heap ? 1 : 0) | (have_contracts ? 2 : 0) | (out_bin ? 4 : 0) | (out_zip ? 8 : 0) |
+			(edges_bin ? 16 : 0) | (dense_ids ? 32 : 0) | (ignore_invalid ? 64 : 0) | (compact ? 128 : 0);
+		if(ptg_ckpt_init(&ck_hdr,fn,flags,nlt,il,ee) || ckpt_init(&ck,fckpt)) {
+			fprintf(stderr,"Error setting up checkpoints!\n");
+			r = 1;
+			goto pt6_end;
+		}
+	}
+	if(resume) {
+		ptg_ckpt_header hdr0 = ck_hdr;
+		FILE* f = fopen(fckpt,"rb");
+		if(!f || ptg_resume_read(f,&hdr0,&ck_hdr,lts,nlt,il,res)) {
+			fprintf(stderr,"Error reading the checkpoint file %s!\n",fckpt);
+			if(f) fclose(f);
+			r = 1;
+			goto pt6_end;
+		}
+		fclose(f);
+		nedges2 = ck_hdr.nedges2;
+		DENEXT = ck_hdr.DENEXT;
 	}
-	N = il->N;
 	
-	ee = edges_read(links);
-	if(zip) pclose(links);
-	else fclose(links);
-	if(!ee) {
-		fprintf(stderr,"Nem sikerült az éleket beolvasni a(z) %s fájlból!\n",flinks);
-		r = 2;
+	/* output files -- if ranks are calculated directly, only written if requested */
+	if(fout || ranks.empty()) for(size_t k=0;k<nlt;k++) if(ptg_open_output(lts + k, fout, out_zip, out_bin, have_contracts,
+			resume ? res.data() + k : 0)) {
+		fprintf(stderr,"Error opening output files!\n");
+		r = 1;
 		goto pt6_end;
 	}
-	eh.e = ee; //ezt valahogy automatikussá kellene tenni (esetleg az edges tömböt teljesen integrálni az edgeheap-be)
-	if(edgehelper) edges_createhelper(ee,il);
+	
+	/* rank calculations: open their output files, start the threads */
+	for(ptg_ranks* pr : ranks) {
+		pr->calc = new ranks_calc(pr->opts);
+		if(pr->calc->open()) {
+			r = 1;
+			goto pt6_end;
+		}
+		lts[pr->lt].ranks.push_back(pr);
+	}
+	for(ptg_ranks* pr : ranks) pr->th = std::thread(ptg_ranks_run,pr);
+	
+	/* skip the transactions already processed before the checkpoint */
+	if(resume) {
+		if(edges_bin) {
+			r = erecord_bin_seek(&eb, ck_hdr.pos);
+		}
+		else for(uint64_t j=0;j<ck_hdr.pos;j++) if(read_table_line_skip(e_rt,0)) { r = 1; break; }
+		if(r) {
+			fprintf(stderr,"Error skipping the transactions already processed!\n");
+			r = 8;
+			goto pt6_end;
+		}
+		fprintf(stderr,"Resuming from checkpoint: %lu transactions processed\n",nedges2);
+	}
 	
 	t3 = time(0);
+	ck_next = t3 + ckpt_interval;
 	r = edges_bin ? erecord_bin_read(&eb, &edge1) : erecord_read(e_rt,&edge1,ignore_invalid);
-	if(r != 0) {
+	if(r != 0 && !(resume && (edges_bin || read_table_get_last_error(e_rt) == T_EOF))) {
 		fprintf(stderr,"Nem sikerült adatokat beolvasni a bemeneti fáljokból!\n");
 		if(!edges_bin) read_table_write_error(e_rt,stderr);
 		r = 8;
 		goto pt6_end;
 	}
 	
-	do {
-		//új rekord az edge változóban, ezt kell feldolgozni, ehhez az rin és rout változókon kell iterálni, amíg el nem érjük a tranzakció időpontját
-		unsigned int timestamp = edge1.timestamp;
-		unsigned int time1 = 0;
-		if(delay > 0 && timestamp > delay) time1 = timestamp - delay;
-		
-		//régi élek törlése
-		r = 0;
-		if(delay > 0) while(eh.hn) {
-			unsigned int ts1 = ee->e[eh.heap[0]].timestamp;
-			if(ts1 >= time1) break; //összes él újabb
-			
-			//az eh.heap[0] él régebbi, törölni kell
-			//fokszámok csökkentése először
-			unsigned int idin = ids_find2(il,ee->e[eh.heap[0]].p1); //változás a korábbi programhoz képest:
-			unsigned int idout = ids_find2(il,ee->e[eh.heap[0]].p2); //az éleknél az eredeti ID-ket tároljuk
-			if(idin >= il->N || idout >= il->N) { //ez itt nem fordulhat elő, az összes ID-nek szerepelnie kell a felsorolásban
-				fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
-				break;
-			}
-			//~ r = deg2_del(d1,il->inlinks[idout]);
-			if(il->inlinks[idout] == 0) { // || il->outlinks[idin] == 0) { //hiba
-				fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
-				r = 1;
-				break;
-			}
-			if(have_contracts) fprintf(test_out,"0\t%u\t%u\t%d\n",il->inlinks[idout],ts1+delay,(int)il->contract[idout]);
-			else fprintf(test_out,"0\t%u\t%u\n",il->inlinks[idout],ts1+delay);
-			ntypes[0]++;
-			
-			r = 0;
-			il->inlinks[idout]--;
-			
-			eh.del0(); //heap átrendezése (legfelső elem törlése)
-		}
-		if(r) break;
-		
-		
-		//feldolgoztuk a be- és kimenő összegeket, most vethetjük össze a statisztikákkal
-		unsigned int idin = ids_find2(il,edge1.in);
-		unsigned int idout = ids_find2(il,edge1.out);
-		
-		if(idin >= il->N || idout >= il->N) { //ez itt nem fordulhat elő, az összes ID-nek szerepelnie kell a felsorolásban
-			fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
-			r = 1;
-			break;
+	if(r == 0 && par_threads > 1) {
+		ptg_par par(lts,nlt,il,ee,par_threads,have_contracts);
+		par.start();
+		par_err = par.run(edge1, [&](erecord* x) {
+				return edges_bin ? erecord_bin_read(&eb, x) : erecord_read(e_rt,x,ignore_invalid);
+			}, nedges2, DE1, DENEXT);
+	}
+	/* note: when resuming, the checkpoint may be at the end of the input */
+	else if(r == 0) {
+		ptg_loop L;
+		L.lts = lts;
+		L.nlt = nlt;
+		L.il = il;
+		L.ee = ee;
+		L.nedges2 = nedges2;
+		L.DE1 = DE1;
+		L.DENEXT = DENEXT;
+		L.fckpt = fckpt;
+		L.ck = &ck;
+		L.ck_hdr = &ck_hdr;
+		L.ckpt_interval = ckpt_interval;
+		L.ck_next = ck_next;
+		if(!edges_bin) {
+			ptg_src_text src = {e_rt, ignore_invalid};
+			proc_err = ptg_run_mode(&L,src,edge1,have_contracts);
 		}
-	
-		if(edge1.in != edge1.out) { //érvényes tranzakciót olvastunk be
-			//a "cél" címmel foglalkozunk
-			unsigned int indeg = il->inlinks[idout];
-			unsigned int type = 2; /* default: new edge */
-			//~ unsigned int outdeg = il->outlinks[idin];
-			r = 0;
-			int new1 = 0; //0, ha aktív az él, ekkor semmit sem kell csinálni
-				//1, ha már szerepelt ez az él, de nem volt aktív (delay-nél nagyobb idő óta)
-				//2, ha még nem szerepelt (timestamp == 0)
-			
-			uint64_t eid = edges_find(ee,edge1.in,edge1.out); //feltesszük, hogy ez az él még nem szerepelt
-			if(eid >= ee->nedges) {
-				fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
-				r = 1;
-				break;
-			}
-			
-			{ //időpont frissítése
-				unsigned int t2 = ee->e[eid].timestamp;
-				ee->e[eid].timestamp = timestamp;
-				if(delay == 0) { if(t2 == 0) new1 = 2; } // új él
-				else { // delay > 0, a heap-et is frissíteni kell
-					if(t2 < time1) { //nem aktív ez az él
-						r = eh.add(eid); //hozzá kell adni a heap-hoz
-						if(r) break; //hiba
-						if(t2 == 0) new1 = 2; //még egyszer sem volt aktív
-						else new1 = 1; //korábban már aktív volt, de már deaktiváltuk
-					}
-					else { //még aktív, az időpontot kell csak frissíteni
-						uint64_t off = ee->e[eid].offset;
-						eh.heapdown(off); //csak lefelé mehet, az új timestamp nagyobb
-					}
-				}
-			}
-			
-			nedges2++;
-			
-			if(il->outtx[idin] == 0) {
-				/* new in node */
-				if(new1 != 2) {
-					fprintf(stderr,"Hiba: inkonzisztens adatok (%u)!\n",__LINE__);
-					r = 1;
-					break;
-				}
-				type = 3;
-			}
-			else switch(new1) {
-				case 0:
-					type = 4;
-					break;
-				case 1:
-					type = 5;
-					break;
-				case 2:
-					type = 2;
-					break;
-			}
-			if(have_contracts) {
-				int contract = 0;
-				if(il->contract[idout]) contract += 1;
-				if(il->contract[idin]) contract += 2;
-				fprintf(test_out,"%u\t%u\t%u\t%d\n",type,indeg,timestamp,contract);
-			}
-			else fprintf(test_out,"%u\t%u\t%u\n",type,indeg,timestamp);
-			ntypes[type]++;
-			
-			if(new1) { //inaktív él, fokszámok frissítése
-				if(have_contracts) fprintf(test_out,"1\t%u\t%u\t%d\n",il->inlinks[idout],timestamp,(int)il->contract[idout]);
-				else fprintf(test_out,"1\t%u\t%u\n",il->inlinks[idout],timestamp);
-				il->inlinks[idout]++;
-				il->outtx[idin]++;
-				r = 0;
-				ntypes[1]++;
-			}
+		else if(eb.packed) {
+			ptg_src_packed src = {&eb};
+			proc_err = ptg_run_mode(&L,src,edge1,have_contracts);
 		}
-		
-		if(DE1) if(nedges2 >= DENEXT) {
-			fprintf(stderr,"%lu él feldolgozva\n",nedges2);
-			DENEXT = nedges2 + DE1;
+		else {
+			ptg_src_raw src = {&eb};
+			proc_err = ptg_run_mode(&L,src,edge1,have_contracts);
 		}
-		
-		//új tranzakció beolvasása
-		r = edges_bin ? erecord_bin_read(&eb, &edge1) : erecord_read(e_rt,&edge1,ignore_invalid);
-	} while(r == 0);
+		nedges2 = L.nedges2;
+		DENEXT = L.DENEXT;
+	}
 	
-	if(!edges_bin && read_table_get_last_error(e_rt) != T_EOF) {
+	if(par_err || proc_err) r = 1;
+	else if(!edges_bin && read_table_get_last_error(e_rt) != T_EOF) {
 		fprintf(stderr,"Nem sikerült adatokat beolvasni a bemeneti fáljokból!\n");
 		read_table_write_error(e_rt,stderr);
 		r = 8;
 	}
+	else if(edges_bin && eb.error) {
+		fprintf(stderr,"Nem sikerült adatokat beolvasni a bemeneti fáljokból!\n");
+		r = 8;
+	}
 	else r = 0;
 	fprintf(stderr,"feldolgozott élek: %u, tranzakciók: %lu\n",nedges,nedges2);
 	t2 = time(0);
@@ -532,21 +2071,60 @@ int main(int argc, char **argv)
 	fprintf(stderr,"futásidő: %u (adatok beolvasása: %u, feldolgozás: %u)\n",(unsigned int)(t2-t1),(unsigned int)(t3-t1),(unsigned int)(t2-t3));
 	
 	/* output */
-	fprintf(stderr,"\ntype\tcount\n");
-	for(i=0;i<6;i++) fprintf(stderr,"%d\t%lu\n",i,ntypes[i]);
+	for(size_t k=0;k<nlt;k++) {
+		if(nlt > 1) fprintf(stderr,"\nlifetime: %s",lts[k].delay_str);
+		fprintf(stderr,"\ntype\tcount\n");
+		for(i=0;i<(compact ? 7 : 6);i++) fprintf(stderr,"%d\t%lu\n",i,lts[k].ntypes[i]);
+	}
+	if(mem_policy) memplace_report(stderr);
+	
+	/* wait for the rank calculations to finish */
+	for(ptg_ranks* pr : ranks) {
+		pr->q.close();
+		pr->th.join();
+		if(pr->calc->close()) pr->err = 1;
+		if(pr->err) r = 1;
+		else fprintf(stderr,"\nranks (%s, %s): %lu lines processed, %lu degree changes, %lu rank calculations\n",
+			pr->args[0],pr->opts.outf_base,pr->calc->lines,pr->calc->l1,pr->calc->l2);
+	}
 	
 pt6_end:
 	
+	for(ptg_ranks* pr : ranks) ptg_ranks_free(pr);
+	/* a checkpoint still being written is finished (even after an error, so that it can be used) */
+	if(fckpt) ckpt_free(&ck);
+	
 	if(!edges_bin) {
-		if(zip) pclose(e);
-		else fclose(e);
+		fclose(e);
 		read_table_free(e_rt);
 	}
 	else erecord_bin_close(&eb);
 	
+	if(lts) {
+		for(size_t k=0;k<nlt;k++) {
+			ptg_lifetime* lt = lts + k;
+			if(lt->evb) {
+				if(lt->evb->f && evbin_writer_close(lt->evb)) {
+					fprintf(stderr,"Error writing output!\n");
+					if(!r) r = 1;
+				}
+				free(lt->evb);
+			}
+			if(lt->zo && lt->zo->close()) {
+				fprintf(stderr,"Error writing output!\n");
+				if(!r) r = 1;
+			}
+			if(lt->out && lt->out != stdout) fclose(lt->out);
+			edgestate_free(&lt->es);
+			lt->inlinks.clean();
+		}
+		delete[] lts;
+	}
 	if(il) ids_free(il);
 	if(ee) edges_free(ee);
 	
+	/* the checkpoint is not needed after a successful run */
+	if(fckpt && !r) unlink(fckpt);
+	
 	return r;
 }
-
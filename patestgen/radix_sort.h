@@ -0,0 +1,190 @@
+/*  -*- C++ -*-
+ * radix_sort.h -- in-place MSD radix sort (American flag sort) for large
+ * 	arrays, used for sorting edges and node IDs
+ *
+ * the data is accessed only through functors, so the same code can sort
+ * arrays of structs (e.g. edges by edgehash) or several arrays together
+ * (e.g. IDs with the contract flags, without proxy iterators):
+ * 	digit(i,level): the level-th byte of the key of the i-th element,
+ * 		starting from the most significant one (0 <= level < nlevels)
+ * 	swap(i,j): exchange the i-th and j-th elements
+ * 	less(i,j): compare the keys of the i-th and j-th elements
+ *
+ * no extra memory is used besides the recursion (at most nlevels deep);
+ * after the first level that splits the input, the buckets are sorted in
+ * parallel by nthreads threads; already sorted input is detected and left
+ * as it is
+ *
+ * Copyright 2020 Daniel Kondor <kondor.dani@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+/* below this size, insertion sort is used */
+#define RADIX_SMALL 32
+
+/* sort the [s,e) range, starting with the given level */
+template<class Digit, class Swap, class Less>
+static void radix_sort_range(size_t s, size_t e, unsigned int level, unsigned int nlevels,
+		const Digit& digit, const Swap& swap, const Less& less) {
+	while(level < nlevels) {
+		if(e - s <= RADIX_SMALL) {
+			for(size_t i=s+1;i<e;i++)
+				for(size_t j=i;j>s && less(j,j-1);j--) swap(j,j-1);
+			return;
+		}
+
+		size_t cnt[256] = {0};
+		for(size_t i=s;i<e;i++) cnt[digit(i,level)]++;
+
+		/* all elements in one bucket: continue with the next level */
+		unsigned int b0 = digit(s,level);
+		if(cnt[b0] == e - s) { level++; continue; }
+
+		size_t next[256];
+		size_t end[256];
+		size_t x = s;
+		for(unsigned int b=0;b<256;b++) {
+			next[b] = x;
+			x += cnt[b];
+			end[b] = x;
+		}
+		/* move elements to their buckets by following cycles of swaps */
+		for(unsigned int b=0;b<256;b++) {
+			while(next[b] < end[b]) {
+				unsigned int v = digit(next[b],level);
+				if(v == b) next[b]++;
+				else {
+					swap(next[b],next[v]);
+					next[v]++;
+				}
+			}
+		}
+
+		if(level + 1 < nlevels) {
+			x = s;
+			for(unsigned int b=0;b<256;b++) {
+				if(cnt[b] > 1) radix_sort_range(x,x+cnt[b],level+1,nlevels,digit,swap,less);
+				x += cnt[b];
+			}
+		}
+		return;
+	}
+}
+
+/* sort n elements; nthreads == 0 means use all available CPUs */
+template<class Digit, class Swap, class Less>
+static void radix_sort(size_t n, unsigned int nlevels, const Digit& digit, const Swap& swap,
+		const Less& less, unsigned int nthreads = 0) {
+	if(n < 2) return;
+
+	/* fast path: check if already sorted */
+	{
+		size_t i;
+		for(i=1;i<n;i++) if(less(i,i-1)) break;
+		if(i == n) return;
+	}
+
+	if(!nthreads) nthreads = std::thread::hardware_concurrency();
+	if(nthreads <= 1 || n < 65536) {
+		radix_sort_range(0,n,0,nlevels,digit,swap,less);
+		return;
+	}
+
+	/* find the first level that splits the input */
+	unsigned int level = 0;
+	size_t cnt[256];
+	for(;level<nlevels;level++) {
+		/* count in parallel */
+		std::vector<size_t> cnts(256*nthreads,0);
+		std::vector<std::thread> threads;
+		for(unsigned int t=0;t<nthreads;t++) threads.emplace_back([&cnts,&digit,t,n,nthreads,level]() {
+			size_t* c = cnts.data() + 256*t;
+			size_t s = n*t/nthreads;
+			size_t e = n*(t+1)/nthreads;
+			for(size_t i=s;i<e;i++) c[digit(i,level)]++;
+		});
+		for(std::thread& t : threads) t.join();
+		for(unsigned int b=0;b<256;b++) {
+			cnt[b] = 0;
+			for(unsigned int t=0;t<nthreads;t++) cnt[b] += cnts[256*t + b];
+		}
+		if(cnt[digit(0,level)] < n) break;
+	}
+	if(level == nlevels) return; /* all keys are the same */
+
+	/* move elements to their buckets on this level */
+	size_t next[256];
+	size_t end[256];
+	size_t start[256];
+	size_t x = 0;
+	for(unsigned int b=0;b<256;b++) {
+		start[b] = x;
+		next[b] = x;
+		x += cnt[b];
+		end[b] = x;
+	}
+	for(unsigned int b=0;b<256;b++) {
+		while(next[b] < end[b]) {
+			unsigned int v = digit(next[b],level);
+			if(v == b) next[b]++;
+			else {
+				swap(next[b],next[v]);
+				next[v]++;
+			}
+		}
+	}
+	if(level + 1 == nlevels) return;
+
+	/* sort the buckets in parallel, largest first */
+	std::vector<unsigned int> buckets;
+	for(unsigned int b=0;b<256;b++) if(cnt[b] > 1) buckets.push_back(b);
+	std::sort(buckets.begin(),buckets.end(),[&cnt](unsigned int x, unsigned int y) { return cnt[x] > cnt[y]; });
+	std::atomic<size_t> bnext(0);
+	std::vector<std::thread> threads;
+	for(unsigned int t=0;t<nthreads;t++) threads.emplace_back([&]() {
+		while(true) {
+			size_t k = bnext++;
+			if(k >= buckets.size()) break;
+			unsigned int b = buckets[k];
+			radix_sort_range(start[b],end[b],level+1,nlevels,digit,swap,less);
+		}
+	});
+	for(std::thread& t : threads) t.join();
+}
+
+/* helper to sort an array of structs by a 64-bit key */
+template<class T, class Key>
+static void radix_sort64(T* a, size_t n, const Key& key, unsigned int nthreads = 0) {
+	radix_sort(n, 8, [a,&key](size_t i, unsigned int level) { return (unsigned int)((key(a[i]) >> (56 - 8*level)) & 0xffU); },
+		[a](size_t i, size_t j) { T tmp = a[i]; a[i] = a[j]; a[j] = tmp; },
+		[a,&key](size_t i, size_t j) { return key(a[i]) < key(a[j]); }, nthreads);
+}
+
+#endif
+
@@ -0,0 +1,376 @@
+/*  -*- C++ -*-
+ * memplace.h -- memory placement policy for the large arrays
+ *
+ * the largest arrays (edges, edge state, heap / queue, node IDs and degrees,
+ * the trees used for ranks) are accessed in a random order, so most of the
+ * time is spent on TLB misses and page walks; this provides allocation
+ * functions that apply the policy selected once at startup:
+ * 	MEMPLACE_THP: transparent huge pages (madvise(MADV_HUGEPAGE))
+ * 	MEMPLACE_HUGETLB: explicit huge pages (mmap() with MAP_HUGETLB; requires
+ * 		pages reserved in /proc/sys/vm/nr_hugepages, falls back to MEMPLACE_THP)
+ * 	MEMPLACE_INTERLEAVE: pages interleaved among all NUMA nodes (mbind())
+ * 	MEMPLACE_PREFAULT: all pages touched right after allocation (in parallel),
+ * 		instead of page faults spread over the computation
+ * memplace_report() shows which of these took effect
+ *
+ * functions:
+ * 	memplace_mmap(), memplace_mremap(), memplace_munmap(): replacements for
+ * 		anonymous mmap(), mremap() and munmap() (memory is zeroed);
+ * 		memplace_munmap() can be used for any other mapping as well
+ * 	memplace_alloc(), memplace_realloc(), memplace_free(): replacements for
+ * 		calloc(), realloc() and free(); if a policy is set, large areas are
+ * 		allocated with memplace_mmap(), otherwise with malloc(); memplace_free()
+ * 		can be used for memory from malloc() as well
+ * mappings created here are recorded in a table (to know their real size,
+ * which is rounded up to the huge page size with MEMPLACE_HUGETLB)
+ *
+ * mbind() is called directly as a system call, so libnuma is not needed
+ *
+ * note: copies of this file are in the patestgen and patestrun
+ * directories, these should be kept in sync
+ *
+ * Copyright 2020 Daniel Kondor <kondor.dani@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of the  nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MEMPLACE_H
+#define MEMPLACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <thread>
+
+#define MEMPLACE_THP 1
+#define MEMPLACE_HUGETLB 2
+#define MEMPLACE_INTERLEAVE 4
+#define MEMPLACE_PREFAULT 8
+
+/* huge page size used with MAP_HUGETLB (the default one on x86-64) */
+#define MEMPLACE_HUGE_SIZE 2097152UL
+/* with a policy set, memplace_alloc() and memplace_realloc() use mmap() above this size */
+#define MEMPLACE_MIN_MAP 4194304UL
+
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB 0x40000
+#endif
+
+struct memplace_state {
+	int flags = 0;
+	unsigned int nthreads = 0; /* threads used for prefaulting (0: all CPUs) */
+	std::vector<unsigned long> nodemask; /* NUMA nodes for interleaving (empty: only one node) */
+	std::map<uintptr_t, std::pair<size_t,bool> > maps; /* mappings created here: size, and if MAP_HUGETLB was used */
+	std::mutex m;
+	/* statistics for memplace_report() */
+	uint64_t n_maps = 0, bytes = 0, bytes_peak = 0; /* number of mappings created, current and peak size */
+	uint64_t n_hugetlb = 0, n_hugetlb_failed = 0;
+	uint64_t n_thp = 0, n_thp_failed = 0;
+	uint64_t n_mbind = 0, n_mbind_failed = 0;
+	uint64_t bytes_prefault = 0;
+	double t_prefault = 0.0;
+};
+
+/* the state is shared among all translation units (this function is not static on purpose) */
+inline memplace_state& memplace_get_state() {
+	static memplace_state s;
+	return s;
+}
+
+/* parse a comma-separated list of policies (thp, hugetlb, interleave, prefault or none);
+ * returns 0 on success */
+static inline int memplace_parse(const char* str, int* flags) {
+	*flags = 0;
+	const char* p = str;
+	while(*p) {
+		size_t len = strcspn(p, ",");
+		if(len == 3 && !strncmp(p, "thp", 3)) *flags |= MEMPLACE_THP;
+		else if(len == 7 && !strncmp(p, "hugetlb", 7)) *flags |= MEMPLACE_HUGETLB;
+		else if(len == 10 && !strncmp(p, "interleave", 10)) *flags |= MEMPLACE_INTERLEAVE;
+		else if(len == 8 && !strncmp(p, "prefault", 8)) *flags |= MEMPLACE_PREFAULT;
+		else if(!(len == 4 && !strncmp(p, "none", 4))) return 1;
+		p += len;
+		if(*p) p++;
+	}
+	return 0;
+}
+
+/* set the policy; this should be done at the start, before allocating the arrays */
+static inline void memplace_set(int flags, unsigned int nthreads = 0) {
+	memplace_state& s = memplace_get_state();
+	s.flags = flags;
+	s.nthreads = nthreads;
+	s.nodemask.clear();
+	if(flags & MEMPLACE_INTERLEAVE) {
+		/* online NUMA nodes, e.g. "0-3" or "0,2-3" */
+		FILE* f = fopen("/sys/devices/system/node/online", "r");
+		char buf[1024];
+		if(f && fgets(buf, sizeof(buf), f)) {
+			std::vector<unsigned long> mask;
+			unsigned int nnodes = 0;
+			for(char* p = buf; *p && *p != '\n'; ) {
+				char* p2;
+				unsigned long a = strtoul(p, &p2, 10), b = a;
+				if(p2 == p) break;
+				if(*p2 == '-') b = strtoul(p2 + 1, &p2, 10);
+				for(unsigned long i = a; i <= b && i < 4096; i++) {
+					size_t j = i / (8*sizeof(unsigned long));
+					if(mask.size() <= j) mask.resize(j+1, 0);
+					mask[j] |= 1UL << (i % (8*sizeof(unsigned long)));
+					nnodes++;
+				}
+				p = p2;
+				if(*p == ',') p++;
+			}
+			if(nnodes > 1) s.nodemask.swap(mask);
+		}
+		if(f) fclose(f);
+	}
+}
+
+/* touch all pages in p (size bytes), in parallel */
+static inline void memplace_prefault(void* p, size_t size) {
+	memplace_state& s = memplace_get_state();
+	unsigned int n = s.nthreads ? s.nthreads : std::thread::hardware_concurrency();
+	size_t pagesize = sysconf(_SC_PAGESIZE);
+	if(!n) n = 1;
+	if(size < 16*MEMPLACE_HUGE_SIZE) n = 1;
+	struct timespec t1, t2;
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	auto touch = [p,size,pagesize](size_t start, size_t end) {
+		volatile char* c = (volatile char*)p;
+		/* write back the same value, so that this is safe for areas already containing data */
+		for(size_t i = start; i < end && i < size; i += pagesize) c[i] = c[i];
+	};
+	if(n == 1) touch(0, size);
+	else {
+		size_t chunk = ((size / n) / pagesize + 1) * pagesize;
+		std::vector<std::thread> threads;
+		for(unsigned int i=0;i<n;i++) threads.emplace_back(touch, i*chunk, (i+1)*chunk);
+		for(std::thread& t : threads) t.join();
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+	std::unique_lock<std::mutex> lock(s.m);
+	s.bytes_prefault += size;
+	s.t_prefault += (t2.tv_sec - t1.tv_sec) + 1e-9*(t2.tv_nsec - t1.tv_nsec);
+}
+
+/* apply the policy to the mapping at p (size bytes); the pages in [prefault_from, size) are prefaulted */
+static inline void memplace_apply(void* p, size_t size, bool hugetlb, size_t prefault_from) {
+	memplace_state& s = memplace_get_state();
+	bool thp_ok = true, mbind_ok = true;
+	if(!hugetlb && (s.flags & (MEMPLACE_THP | MEMPLACE_HUGETLB)))
+		thp_ok = (madvise(p, size, MADV_HUGEPAGE) == 0);
+	if(!s.nodemask.empty())
+		mbind_ok = (syscall(SYS_mbind, p, size, MPOL_INTERLEAVE, s.nodemask.data(),
+			8*sizeof(unsigned long)*s.nodemask.size(), 0) == 0);
+	if(!prefault_from) { /* only count new mappings, not the ones grown by memplace_mremap() */
+		std::unique_lock<std::mutex> lock(s.m);
+		if(!hugetlb && (s.flags & (MEMPLACE_THP | MEMPLACE_HUGETLB))) {
+			if(thp_ok) s.n_thp++;
+			else s.n_thp_failed++;
+		}
+		if(!s.nodemask.empty()) {
+			if(mbind_ok) s.n_mbind++;
+			else s.n_mbind_failed++;
+		}
+	}
+	if((s.flags & MEMPLACE_PREFAULT) && prefault_from < size)
+		memplace_prefault((char*)p + prefault_from, size - prefault_from);
+}
+
+/* size actually mapped for a request of size bytes */
+static inline size_t memplace_map_size(size_t size) {
+	if(!size) size = 1;
+	if(memplace_get_state().flags & MEMPLACE_HUGETLB)
+		size = ((size + MEMPLACE_HUGE_SIZE - 1) / MEMPLACE_HUGE_SIZE) * MEMPLACE_HUGE_SIZE;
+	return size;
+}
+
+/* replacement for an anonymous mmap() -- returns MAP_FAILED on error */
+static inline void* memplace_mmap(size_t size) {
+	memplace_state& s = memplace_get_state();
+	size_t len = memplace_map_size(size);
+	void* p = MAP_FAILED;
+	bool hugetlb = false;
+	if(s.flags & MEMPLACE_HUGETLB) {
+		p = mmap(0, len, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+		hugetlb = (p != MAP_FAILED);
+	}
+	if(p == MAP_FAILED) p = mmap(0, len, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if(p == MAP_FAILED) return p;
+	{
+		std::unique_lock<std::mutex> lock(s.m);
+		s.maps[(uintptr_t)p] = std::make_pair(len, hugetlb);
+		s.n_maps++;
+		s.bytes += len;
+		if(s.bytes > s.bytes_peak) s.bytes_peak = s.bytes;
+		if(s.flags & MEMPLACE_HUGETLB) {
+			if(hugetlb) s.n_hugetlb++;
+			else s.n_hugetlb_failed++;
+		}
+	}
+	memplace_apply(p, len, hugetlb, 0);
+	return p;
+}
+
+/* replacement for munmap(); for mappings not created by memplace_mmap(), size is used */
+static inline int memplace_munmap(void* p, size_t size) {
+	memplace_state& s = memplace_get_state();
+	{
+		std::unique_lock<std::mutex> lock(s.m);
+		auto it = s.maps.find((uintptr_t)p);
+		if(it != s.maps.end()) {
+			size = it->second.first;
+			s.bytes -= size;
+			s.maps.erase(it);
+		}
+	}
+	return munmap(p, size);
+}
+
+/* replacement for mremap(p, old_size, new_size, MREMAP_MAYMOVE) -- returns MAP_FAILED on error */
+static inline void* memplace_mremap(void* p, size_t old_size, size_t new_size) {
+	memplace_state& s = memplace_get_state();
+	bool found = false, hugetlb = false;
+	{
+		std::unique_lock<std::mutex> lock(s.m);
+		auto it = s.maps.find((uintptr_t)p);
+		if(it != s.maps.end()) {
+			found = true;
+			old_size = it->second.first;
+			hugetlb = it->second.second;
+		}
+	}
+	if(!found) return mremap(p, old_size, new_size, MREMAP_MAYMOVE);
+	size_t len = memplace_map_size(new_size);
+	if(len == old_size) return p;
+	void* p2 = mremap(p, old_size, len, MREMAP_MAYMOVE);
+	if(p2 == MAP_FAILED) {
+		/* mremap() does not work for huge pages on older kernels, copy the contents instead */
+		p2 = memplace_mmap(new_size);
+		if(p2 == MAP_FAILED) return p2;
+		memcpy(p2, p, old_size < len ? old_size : len);
+		memplace_munmap(p, old_size);
+		return p2;
+	}
+	{
+		std::unique_lock<std::mutex> lock(s.m);
+		s.maps.erase((uintptr_t)p);
+		s.maps[(uintptr_t)p2] = std::make_pair(len, hugetlb);
+		s.bytes += len;
+		s.bytes -= old_size;
+		if(s.bytes > s.bytes_peak) s.bytes_peak = s.bytes;
+	}
+	if(len > old_size) memplace_apply(p2, len, hugetlb, old_size);
+	return p2;
+}
+
+/* replacement for calloc(size, 1) -- returns 0 on error */
+static inline void* memplace_alloc(size_t size) {
+	if(!memplace_get_state().flags || size < MEMPLACE_MIN_MAP) return calloc(size ? size : 1, 1);
+	void* p = memplace_mmap(size);
+	return (p == MAP_FAILED) ? 0 : p;
+}
+
+/* true if p was allocated by memplace_mmap() */
+static inline bool memplace_is_mapped(void* p) {
+	memplace_state& s = memplace_get_state();
+	std::unique_lock<std::mutex> lock(s.m);
+	return s.maps.count((uintptr_t)p) > 0;
+}
+
+/* replacement for free() */
+static inline void memplace_free(void* p) {
+	if(!p) return;
+	if(memplace_is_mapped(p)) memplace_munmap(p, 0);
+	else free(p);
+}
+
+/* replacement for realloc(); old_size is the current size of the area
+ * (only used when moving from malloc() to mmap()) -- returns 0 on error */
+static inline void* memplace_realloc(void* p, size_t old_size, size_t new_size) {
+	if(!p) return new_size ? memplace_alloc(new_size) : 0;
+	if(memplace_is_mapped(p)) {
+		void* p2 = memplace_mremap(p, old_size, new_size);
+		return (p2 == MAP_FAILED) ? 0 : p2;
+	}
+	if(!memplace_get_state().flags || new_size < MEMPLACE_MIN_MAP) return realloc(p, new_size);
+	void* p2 = memplace_mmap(new_size);
+	if(p2 == MAP_FAILED) return 0;
+	memcpy(p2, p, old_size < new_size ? old_size : new_size);
+	free(p);
+	return p2;
+}
+
+/* show the policy used and its results */
+static inline void memplace_report(FILE* f) {
+	memplace_state& s = memplace_get_state();
+	std::unique_lock<std::mutex> lock(s.m);
+	fprintf(f, "memory placement: %lu areas allocated, %lu currently (%.1f MiB, peak: %.1f MiB)\n",
+		s.n_maps, (uint64_t)s.maps.size(), s.bytes / 1048576.0, s.bytes_peak / 1048576.0);
+	if(s.flags & MEMPLACE_HUGETLB) fprintf(f, "\thugetlb: %lu areas (failed for %lu, using %s instead)\n",
+		s.n_hugetlb, s.n_hugetlb_failed, "transparent huge pages");
+	if(s.flags & (MEMPLACE_THP | MEMPLACE_HUGETLB)) {
+		char buf[256] = "unknown";
+		FILE* f2 = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+		if(f2) {
+			if(fgets(buf, sizeof(buf), f2)) buf[strcspn(buf, "\n")] = 0;
+			fclose(f2);
+		}
+		fprintf(f, "\ttransparent huge pages: %lu areas (failed for %lu; system setting: %s)\n",
+			s.n_thp, s.n_thp_failed, buf);
+	}
+	if(s.flags & MEMPLACE_INTERLEAVE) {
+		if(s.nodemask.empty()) fprintf(f, "\tNUMA interleave: not used (only one node)\n");
+		else fprintf(f, "\tNUMA interleave: %lu areas (failed for %lu)\n", s.n_mbind, s.n_mbind_failed);
+	}
+	if(s.flags & MEMPLACE_PREFAULT) fprintf(f, "\tprefault: %.1f MiB in %.2f s\n",
+		s.bytes_prefault / 1048576.0, s.t_prefault);
+	/* huge pages actually used by this process */
+	FILE* f3 = fopen("/proc/self/smaps_rollup", "r");
+	if(f3) {
+		char line[256];
+		while(fgets(line, sizeof(line), f3))
+			if(!strncmp(line, "AnonHugePages:", 14) || !strncmp(line, "Private_Hugetlb:", 16)) fprintf(f, "\t%s", line);
+		fclose(f3);
+	}
+}
+
+#endif
+
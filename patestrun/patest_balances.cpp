@@ -54,6 +54,8 @@
 #include <unordered_map>
 
 #include "read_table.h"
+#include "evbin.h"
+#include "zfile.h"
 
 struct set_pow {
 	double operator () (int64_t y, double a) const {
@@ -168,8 +170,6 @@ bool read_out(read_table2& rt, record& r) {
 
 
 static char gzip0[] = "/bin/gzip -c";
-static char zcat[] = "/bin/zcat";
-static char xzcat[] = "/usr/bin/xzcat";
 
 
 int main(int argc, char **argv)
@@ -197,8 +197,6 @@ int main(int argc, char **argv)
 
 	time_t t1 = time(0);
 	bool zip = true; //kimeneti fájlok tömörítve
-	bool in_zip = false; //bemeneti fájlok tömörítve
-	bool in_xz = false; //input is compressed with xz
 	
 	int64_t thres = 1; //csak az e feletti összegekkel foglalkozunk
 	
@@ -206,6 +204,7 @@ int main(int argc, char **argv)
 
 	bool only_generate = false; /* if true, only generate "events", i.e. changes in balances */
 	bool read_events = false; /* if true, instead of reading transactions, read "events" from stdin */
+	const char* fbin = 0; /* with -g or -r: write / read events in binary format (see evbin.h) to / from this file */
 	bool use_map = false;
 	bool forget_old = false; /* if true, "forget" addresses with zero balance (to limit the size of hashtable) */
 	
@@ -235,10 +234,9 @@ int main(int argc, char **argv)
 			zip = false;
 			break;
 		case 'Z':
-			in_zip = true;
-			break;
 		case 'X':
-			in_xz = true;
+			/* compressed input files (gzip or xz) are detected automatically
+			 * (see zfile.h), these options are kept for compatibility */
 			break;
 		case 'a':
 				for( ; i+1 < argc && (isdigit(argv[i+1][0]) || argv[i+1][0] == '.'); i++ ) {
@@ -279,6 +277,10 @@ int main(int argc, char **argv)
 		case 'r':
 			read_events = true;
 			break;
+		case 'b':
+			fbin = argv[i+1];
+			i++;
+			break;
 		case 'm':
 			use_map = true;
 			break;
@@ -303,25 +305,14 @@ int main(int argc, char **argv)
 		if(ftxin) ftxin = 0;
 		if(ftxout) ftxout = 0;
 	}
+	if(fbin && !(read_events || only_generate)) {
+		fprintf(stderr,"Binary event file (-b) can only be used together with -g or -r!\n");
+		return 1;
+	}
 	if(histogram_output) zip = !zip;
 	
 	DENEXT = DE1;
 	
-	char* fntmp = 0;
-	if(in_zip || in_xz) {
-		unsigned int l1 = ftxin ? strlen(ftxin) : 0;
-		unsigned int l2 = ftxout ? strlen(ftxout) : 0;
-		if(l2 > l1) l1 = l2;
-		
-		if(l1) {
-			fntmp = (char*)malloc(sizeof(char)*(l1 + strlen(xzcat) + 4));
-			if(!fntmp) {
-				fprintf(stderr,"Nem sikerült memóriát lefoglalni!\n");
-				return 2;
-			}
-		}
-	}
-	
 	/* trees -- only one is used depending if exponents are given or not (a has >0 elements) */
 	orbtree::NVPower2<int64_t> p(a);
 	orbtree::NVPowerMulti2<std::pair<int64_t, unsigned int> > p2(a);
@@ -331,24 +322,18 @@ int main(int argc, char **argv)
 	expmap emap(p2);
 	
 	
+	/* input files are decompressed in separate threads if needed (see zfile.h) */
 	FILE* in = 0;
-	if(ftxin) {
-		if(in_zip || in_xz) {
-			sprintf(fntmp,"%s %s",in_xz ? xzcat : zcat,ftxin);
-			in = popen(fntmp,"r");
-		}
-		else in = fopen(ftxin,"r");
-	}
+	if(ftxin) in = zfile_open(ftxin);
 	FILE* out = 0;
-	if(ftxout) {
-		if(in_zip || in_xz) {
-			sprintf(fntmp,"%s %s",in_xz ? xzcat : zcat,ftxout);
-			out = popen(fntmp,"r");
-		}
-		else out = fopen(ftxout,"r");
-	}
+	if(ftxout) out = zfile_open(ftxout);
 	else out = stdin;
-	if(fntmp) free(fntmp);
+	if((ftxin && !in) || !out) {
+		fprintf(stderr,"Error opening input files!\n");
+		if(in) fclose(in);
+		if(out && out != stdin) fclose(out);
+		return 1;
+	}
 	
 	//kimeneti fájlok -- minden exponenshez külön fájl, tömörítve
 	FILE** out1 = 0;
@@ -406,6 +391,22 @@ int main(int argc, char **argv)
 	/* keep track of address balances */
 	std::unordered_map<uint64_t,int64_t> balances;
 	FILE* generate_out = stdout;
+	evbin_reader evr;
+	evbin_writer evw;
+	int evr_res = 0;
+	if(fbin) {
+		if(read_events) {
+			if(evbin_open(&evr,fbin,EVBIN_BAL)) return 1;
+		}
+		else {
+			generate_out = fopen(fbin,"w");
+			if(!generate_out || evbin_writer_open(&evw,generate_out,EVBIN_BAL,0)) {
+				fprintf(stderr,"Error opening output file %s!\n",fbin);
+				if(generate_out) fclose(generate_out);
+				return 1;
+			}
+		}
+	}
 	
 	std::vector<std::vector<uint64_t> > histograms;
 	std::vector<std::vector<uint64_t> > histograms2;
@@ -430,8 +431,18 @@ int main(int argc, char **argv)
 		bool txout_event = true;
 		
 		if(read_events) {
-			if(!rtout.read_line()) break;
-			if(!rtout.read(old_bal,new_bal)) break;
+			if(fbin) {
+				evbin_bal ev;
+				evr_res = evbin_read_bal(&evr,&ev);
+				if(evr_res) break;
+				old_bal = ev.old_bal;
+				new_bal = ev.new_bal;
+				txid = ev.txid;
+			}
+			else {
+				if(!rtout.read_line()) break;
+				if(!rtout.read(old_bal,new_bal)) break;
+			}
 			txout++;
 		}
 		else {
@@ -465,7 +476,10 @@ int main(int argc, char **argv)
 			}
 		}
 		
-		if(only_generate) fprintf(generate_out,"%ld\t%ld\t%lu\n",old_bal,new_bal,txid);
+		if(only_generate) {
+			if(fbin) evbin_write_bal(&evw,old_bal,new_bal,txid);
+			else fprintf(generate_out,"%ld\t%ld\t%lu\n",old_bal,new_bal,txid);
+		}
 		else {
 			if(old_bal > thres) {
 				bool skip = false;
@@ -546,25 +560,32 @@ int main(int argc, char **argv)
 	}
 	
 	r = 0;
-	if(rtout.get_last_error() != T_EOF) {
+	if(fbin && read_events) {
+		if(evr_res < 0) {
+			fprintf(stderr,"Error reading input file %s!\n",fbin);
+			r = 1;
+		}
+		evbin_close(&evr);
+	}
+	else if(rtout.get_last_error() != T_EOF) {
 		fprintf(stderr,"Error reading input:\n");
 		rtout.write_error(stderr);
 		r = 1;
 	}
+	if(fbin && only_generate) {
+		if(evbin_writer_close(&evw) || fclose(generate_out)) {
+			fprintf(stderr,"Error writing output file %s!\n",fbin);
+			r = 1;
+		}
+	}
 	if(in && !( rtin.get_last_error() == T_EOF || rtin.get_last_error() == T_OK ) ) {
 		fprintf(stderr,"Error reading input:\n");
 		rtin.write_error(stderr);
 		r = 1;
 	}
 	
-	if(in) {
-		if(in_zip || in_xz) pclose(in);
-		else fclose(in);
-	}
-	if(out && out != stdin) {
-		if(in_zip || in_xz) pclose(out);
-		else fclose(out);
-	}
+	if(in) fclose(in);
+	if(out && out != stdin) fclose(out);
 	
 	if(a.size()) {
 		/* close output files or write output */
@@ -0,0 +1,421 @@
+/*  -*- C++ -*-
+ * ranks.h -- calculating ranks of degrees using red-black trees for a
+ * 	stream of events (as generated by patest_gen.c); used by the ptr
+ * 	program (patest_ranks.cpp) and also by ptg (with the -R option) to
+ * 	process events directly, without writing them out
+ *
+ * Copyright 2019-2020 Daniel Kondor <kondor.dani@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of the  nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ */
+
+#ifndef RANKS_H
+#define RANKS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <vector>
+#include <stdexcept>
+#include "orbtree.h"
+#include "zout.h"
+
+/* trees */
+typedef orbtree::rankmultisetC<unsigned int> ranktree;
+typedef orbtree::orbmultisetC<unsigned int, orbtree::NVPower2<unsigned int> > exptree;
+
+
+/* maps -- for more compact representation */
+struct map_rank {
+	unsigned int operator () (const std::pair<unsigned int, unsigned int>& p) const { return p.second; }
+	typedef std::pair<unsigned int, unsigned int> argument_type;
+	typedef unsigned int result_type;
+};
+struct map_pow {
+	double operator () (const std::pair<unsigned int, unsigned int>&p, double a) const {
+		double x = (double)(p.first);
+		double cnt = (double)(p.second);
+		return cnt*pow(x,a);
+	}
+};
+
+typedef orbtree::simple_mapC<unsigned int, unsigned int, map_rank> rankmap;
+typedef orbtree::orbmapC<unsigned int, unsigned int, orbtree::NVPowerMulti2<std::pair<unsigned int, unsigned int> > > expmap;
+
+template<class tree>
+inline void change_deg_tree(tree& t, unsigned int old_deg, unsigned int new_deg) {
+	if(old_deg) {
+		auto it = t.find(old_deg);
+		if(it == t.end()) throw std::runtime_error("degree not found!\n");
+		t.erase(it);
+	}
+	if(new_deg) t.insert(new_deg);
+}
+
+template<class tree>
+inline void change_deg_map(tree& t, unsigned int old_deg, unsigned int new_deg) {
+	if(old_deg) {
+		auto it = t.find(old_deg);
+		if(it == t.end()) throw std::runtime_error("degree not found!\n");
+		unsigned int cnt1 = it->second;
+		if(cnt1 == 1) t.erase(it);
+		else it.set_value(cnt1-1);
+	}
+
+	/* try to insert */
+	if(new_deg) {
+		auto res = t.insert(orbtree::trivial_pair<unsigned int,unsigned int>(new_deg,1U));
+		if(!res.second) {
+			/* already exists, add one */
+			auto it = res.first;
+			unsigned int cnt1 = it->second;
+			it.set_value(cnt1+1);
+		}
+	}
+}
+
+
+template<class tree, class T>
+inline void get_ranks(tree& t, unsigned int deg, T* rank, T* cdf) {
+	if(deg) {
+		auto it = t.lower_bound(deg);
+		if(it == t.end() || it.key() != deg) throw std::runtime_error("degree not found!\n");
+		t.get_sum_node(it,rank);
+	}
+	t.get_norm_fv(cdf);
+}
+
+template<class tree, class T>
+inline void get_ranks_simple(tree& t, unsigned int deg, T* rank, T* cdf) {
+	if(deg) {
+		auto it = t.lower_bound(deg);
+		if(it == t.end() || it.key() != deg) throw std::runtime_error("degree not found!\n");
+		*rank = t.get_sum_node(it);
+	}
+	t.get_norm_fv(cdf);
+}
+
+
+static inline int ranks_strtodint(char* a,unsigned int* delay) {
+	char* a1 = 0;
+	unsigned int delay2 = strtoul(a,&a1,10);
+	if(a1 == a) {
+		return 1;
+
+	}
+	if(*a1) switch(*a1) {
+		case 'h':
+			*delay = delay2*3600;
+			break;
+		case 'd':
+			*delay = delay2*86400;
+			break;
+		case 'w':
+			*delay = delay2*604800;
+			break;
+		case 'm':
+			*delay = delay2*2592000;
+			break;
+		case 'y':
+			*delay = delay2*31536000;
+			break;
+		case ' ':
+		case '\t':
+		case '\r':
+		case '\n':
+			*delay = delay2;
+			break;
+		default:
+			return 1;
+	}
+	else *delay = delay2;
+	return 0;
+}
+
+/* write out histograms to the given output files; also zeroes out all histograms */
+static inline void write_histogram(std::vector<std::vector<uint64_t> >& histograms, std::vector<uint64_t>& cnts,
+		double histogram_bins, zout** out, unsigned int ts) {
+	const size_t nbins = (size_t)ceil(1.0 / histogram_bins);
+	for(size_t i=0;i<histograms.size();i++) {
+		for(size_t j=0;j<nbins;j++) {
+			zout* z = out[i];
+			if(ts) { z->write_uint(ts); z->put('\t'); }
+			z->printf("%f\t", histogram_bins*((double)j));
+			z->write_uint(histograms[i][j]);
+			z->put('\t');
+			z->write_uint(cnts[i]);
+			z->put('\n');
+			histograms[i][j] = 0;
+		}
+		cnts[i] = 0;
+	}
+}
+
+
+/* options for calculating the ranks (these correspond to the command line
+ * options of ptr, see ranks_parse_arg() below) */
+struct ranks_options {
+	const char* outf_base = 0; /* output base filename */
+	std::vector<double> a; /* exponents to use -- if none is given, only ranks are output (to stdout) */
+	bool zip = true; /* should compress output files */
+	size_t debug_out = 0;
+	bool use_map = false;
+	bool histogram_output = false;
+	double histogram_bins = 0.0001;
+	unsigned int histogram_time_freq = 0; // if this is > 0, write out histograms at this given time intervals
+	int contract_filter = -1; /* if >= 0, only use events with this value in the contract column */
+};
+
+/* process the option in argv[i] (and its parameters); returns true if it
+ * was recognized, in this case i is updated to point to the last parameter used */
+static inline bool ranks_parse_arg(ranks_options& o, int argc, char** argv, int& i) {
+	if(argv[i][0] != '-') return false;
+	switch(argv[i][1]) {
+		case 'a':
+			for( ; i+1 < argc && (isdigit(argv[i+1][0]) || argv[i+1][0] == '.'); i++ ) {
+				char* tmp = argv[i+1];
+				double a1 = strtod(argv[i+1],&tmp);
+				if(tmp == argv[i+1]) { fprintf(stderr,"Invalid exponent value: %s!\n",argv[i+1]); break; }
+				o.a.push_back(a1);
+			}
+			return true;
+		case 'o':
+			if(i+1 < argc) o.outf_base = argv[i+1];
+			i++;
+			return true;
+		case 'z':
+			o.zip = false;
+			return true;
+		case 'D':
+			if(i+1 < argc) o.debug_out = strtoul(argv[i+1],0,10);
+			i++;
+			return true;
+		case 'm':
+			o.use_map = true;
+			return true;
+		case 'h':
+			if(i+1 < argc) o.histogram_bins = atof(argv[i+1]);
+			i++;
+		case 'H':
+			o.histogram_output = true;
+			return true;
+		case 'T':
+			if(i+1 == argc || ranks_strtodint(argv[i+1],&o.histogram_time_freq))
+				fprintf(stderr,"Invalid parameter: %s %s!\n",argv[i],i+1 < argc ? argv[i+1] : "");
+			else i++;
+			return true;
+		case 'C':
+			if(i+1 < argc) o.contract_filter = atoi(argv[i+1]);
+			i++;
+			return true;
+		default:
+			return false;
+	}
+}
+
+
+/* rank calculation state: trees storing the current degrees and
+ * output files (or histograms) for each exponent and event type */
+class ranks_calc {
+	public:
+		explicit ranks_calc(const ranks_options& o):opts(o),p(o.a),p2(o.a),et(p),emap(p2) { }
+		~ranks_calc() { close(); }
+
+		/* open output files, allocate histograms -- returns 0 on success */
+		int open();
+		/* process one event (deg2 is the new degree for type 6 events);
+		 * throws an exception on invalid input */
+		void event(unsigned int type, unsigned int deg, unsigned int ts, unsigned int deg2 = 0);
+		/* write out remaining histograms, close the output files;
+		 * returns 0 on success, 1 if there was an error writing the output */
+		int close();
+
+		const ranks_options& options() const { return opts; }
+
+		size_t lines = 0; /* number of events processed */
+		size_t l1 = 0; /* number of degree changes */
+		size_t l2 = 0; /* number of rank calculations */
+
+	protected:
+		/* map type ids (2-5) to output file indexes */
+		static const unsigned int ntypes = 4;
+
+		ranks_options opts;
+		/* trees -- only one is used depending if exponents are given or not (a has >0 elements) */
+		orbtree::NVPower2<unsigned int> p;
+		orbtree::NVPowerMulti2<std::pair<unsigned int,unsigned int> > p2;
+		ranktree rt;
+		rankmap rmap;
+		exptree et;
+		expmap emap;
+
+		zout** out = 0; /* output files, compressed in parallel (see zout.h) */
+		std::vector<std::vector<uint64_t> > histograms;
+		std::vector<uint64_t> cnts;
+		unsigned int tsnext = 0;
+		unsigned int ts1 = 0;
+		size_t debug_out_next = 0;
+};
+
+inline int ranks_calc::open() {
+	if(opts.histogram_output) opts.zip = !opts.zip;
+	debug_out_next = opts.debug_out;
+
+	if(opts.a.size()) {
+		if(!opts.outf_base) { fprintf(stderr,"No output file name given!\n"); return 1; }
+		bool err = false;
+		char* tmp = (char*)malloc( sizeof(char) * ( strlen(opts.outf_base) + 40 ) );
+		if(!tmp) { fprintf(stderr,"Error allocating memory!\n"); return 1; }
+		out = (zout**)calloc(ntypes*opts.a.size(),sizeof(zout*));
+		if(!out) { fprintf(stderr,"Error allocating memory!\n"); free(tmp); return 1; }
+		for(size_t i=0;i<opts.a.size();i++) {
+			double a1 = opts.a[i];
+			for(unsigned int t=0;t<ntypes;t++) {
+				sprintf(tmp,"%s-%.2f-%u.dat%s",opts.outf_base,a1,t+2,opts.zip ? ".gz" : "");
+				out[i*ntypes + t] = zout::open(tmp, opts.zip ? ZOUT_GZIP : ZOUT_PLAIN);
+				if(!out[i*ntypes + t]) { err = true; break; }
+			}
+			if(err) break;
+		}
+		free(tmp);
+
+		if(err) {
+			fprintf(stderr,"Error opening output files!\n");
+			for(size_t i=0;i<ntypes*opts.a.size();i++) if(out[i]) out[i]->close();
+			free(out);
+			out = 0;
+			return 1;
+		}
+	}
+
+	if(opts.histogram_output) {
+		size_t nbins = (size_t)ceil(1.0 / opts.histogram_bins);
+		histograms.resize(ntypes * opts.a.size());
+		cnts.resize(ntypes * opts.a.size(),0UL);
+		for(std::vector<uint64_t>& h : histograms) h.resize(nbins,0UL);
+	}
+	return 0;
+}
+
+inline void ranks_calc::event(unsigned int type, unsigned int deg, unsigned int ts, unsigned int deg2) {
+	ts1 = ts;
+	if(opts.histogram_output && opts.histogram_time_freq) {
+		if(!tsnext) tsnext = ts1 + opts.histogram_time_freq;
+		if(ts1 >= tsnext) {
+			write_histogram(histograms, cnts, opts.histogram_bins, out, tsnext);
+			do tsnext += opts.histogram_time_freq; while(tsnext <= ts1);
+		}
+	}
+
+	const std::vector<double>& a = opts.a;
+	if(type == 0 || type == 1 || type == 6) {
+		/* decrease / increase degree, or change it to deg2 in one step (type 6) */
+		unsigned int old_deg = deg;
+		unsigned int new_deg;
+		if(type == 0) {
+			if(!old_deg) throw std::runtime_error("Invalid input: cannot decrease zero degree!\n");
+			new_deg = old_deg-1;
+		}
+		else if(type == 1) new_deg = old_deg+1;
+		else new_deg = deg2;
+
+		if(opts.use_map) {
+			if(a.size()) change_deg_map(emap,old_deg,new_deg);
+			else change_deg_map(rmap,old_deg,new_deg);
+		}
+		else {
+			if(a.size()) change_deg_tree(et,old_deg,new_deg);
+			else change_deg_tree(rt,old_deg,new_deg);
+		}
+		l1++;
+	}
+	else {
+		/* calculate rank, write output */
+		if(type < 2 || type > 5) throw std::runtime_error("Invalid input: unknown event type!\n");
+		unsigned int o = type - 2;
+
+		if(a.size()) {
+			double rank[a.size()];
+			double cdf[a.size()];
+			if(opts.use_map) get_ranks(emap,deg,rank,cdf);
+			else get_ranks(et,deg,rank,cdf);
+			if(!deg) for(double& x : rank) x = 0.0;
+			else for(size_t i=0;i<a.size();i++) rank[i] /= cdf[i];
+
+			for(size_t i=0;i<a.size();i++) {
+				size_t idx = i*ntypes + o;
+				if(opts.histogram_output) {
+					double r1 = rank[i];
+					if(r1 < 0.0 || r1 > 1.0) throw std::runtime_error("Invalid rank!\n");
+					size_t b = (size_t)floor(r1 / opts.histogram_bins);
+					histograms[idx][b]++;
+					cnts[idx]++;
+				}
+				else {
+					zout* z = out[idx];
+					z->write_g(rank[i]);
+					z->put('\n');
+				}
+			}
+		}
+		else {
+			unsigned int rank = 0,cdf;
+			if(opts.use_map) get_ranks_simple(rmap,deg,&rank,&cdf);
+			else get_ranks_simple(rt,deg,&rank,&cdf);
+			fprintf(stdout,"%u\t%u\t%u\t%u\n",type,deg,rank,cdf);
+		}
+		l2++;
+	}
+	lines++;
+
+	if(opts.debug_out && lines >= debug_out_next) {
+		fprintf(stderr,"%lu lines processed, %lu degree changes, %lu rank calculations\n",lines,l1,l2);
+		debug_out_next += opts.debug_out;
+	}
+}
+
+inline int ranks_calc::close() {
+	if(!out) return 0;
+	/* close output files or write output */
+	if(opts.histogram_output && (!opts.histogram_time_freq || ts1 < tsnext))
+		write_histogram(histograms, cnts, opts.histogram_bins, out, tsnext);
+
+	int ret = 0;
+	for(size_t i=0;i<ntypes*opts.a.size();i++) if(out[i]->close()) ret = 1;
+	free(out);
+	out = 0;
+	if(ret) fprintf(stderr,"Error writing output files (%s)!\n",opts.outf_base);
+	return ret;
+}
+
+#endif
+
@@ -78,6 +78,7 @@
 #include <type_traits>
 #include <stdlib.h>
 #include <string.h>
+#include "memplace.h"
 
 
 /* constexpr if support only for c++17 or newer */
@@ -129,8 +130,9 @@ class vector {
 		static constexpr size_t p_max_capacity = std::numeric_limits<size_t>::max() / sizeof(T);
 		
 		/// \brief Reallocate memory to the given new size
+		/// (large vectors are placed according to the policy set in memplace.h)
 		bool change_size(size_t new_size) {
-			T* tmp = (T*)realloc(start,new_size*sizeof(T));
+			T* tmp = (T*)memplace_realloc(start,p_capacity*sizeof(T),new_size*sizeof(T));
 			if(!tmp) return false;
 			start = tmp;
 			p_capacity = new_size;
@@ -185,7 +187,7 @@ class vector {
 		~vector() {
 			/* call destructors of existing elements -- these are not allowed to throw an exception! */
 			if(p_size) resize(0);
-			if(start) free(start);
+			if(start) memplace_free(start);
 		}
 		
 		
@@ -407,7 +409,7 @@ vector<T>& vector<T>::operator = (const vector<T>& v) {
 template<class T>
 vector<T>& vector<T>::operator = (vector<T>&& v) {
 	resize(0);
-	if(start) free(start);
+	if(start) memplace_free(start);
 	start = nullptr;
 	swap(v);
 }
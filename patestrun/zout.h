@@ -0,0 +1,477 @@
+/*  -*- C++ -*-
+ * zout.h -- buffered text output with compression done in parallel,
+ * 	used instead of fprintf() to a popen("gzip -c > ...") pipe
+ *
+ * the output is collected in blocks (ZOUT_BLOCK bytes); numbers are
+ * formatted directly into the block (write_uint(), write_g(), etc.);
+ * full blocks are compressed by a thread pool shared among all output
+ * streams, and written to the file in order by whichever thread finishes
+ * compressing the next block, so the calling thread only waits if too
+ * many blocks are pending
+ *
+ * each block is compressed separately, as a gzip member (or zstd frame);
+ * a file consisting of several members is a valid gzip file, which can be
+ * read by zcat, gzip -d, etc. (the compression ratio is only slightly worse
+ * than compressing the whole file at once)
+ *
+ * requires linking with -lz (and -lzstd if ZFILE_ZSTD is defined) and -pthread
+ *
+ * note: copies of this file are in the patestgen and patestrun
+ * directories, these should be kept in sync
+ *
+ * Copyright 2020 Daniel Kondor <kondor.dani@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of the  nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * example usage:
+
+zout* z = zout::open("out.dat.gz", ZOUT_GZIP); // fn == 0 means stdout
+if(!z) { ... } // error opening file
+z->write_uint(x);
+z->put('\t');
+z->write_g(y); // same as printf("%g",y)
+z->put('\n');
+if(z->close()) { ... } // error writing the output; z is deleted in any case
+
+ */
+
+#ifndef ZOUT_H
+#define ZOUT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <zlib.h>
+#ifdef ZFILE_ZSTD
+#include <zstd.h>
+#endif
+
+/* size of one block */
+#ifndef ZOUT_BLOCK
+#define ZOUT_BLOCK 1048576UL
+#endif
+/* extra space at the end of a block, numbers are written without checking
+ * the size, if less than this is free, the block is sent for compression */
+#define ZOUT_SLACK 256
+
+enum zout_format { ZOUT_PLAIN = 0, ZOUT_GZIP, ZOUT_ZSTD };
+
+/* threads compressing the blocks */
+class zout_pool {
+	public:
+		explicit zout_pool(unsigned int nthreads = 0) {
+			if(!nthreads) nthreads = std::thread::hardware_concurrency();
+			if(!nthreads) nthreads = 1;
+			for(unsigned int i=0;i<nthreads;i++) threads.emplace_back([this]() { run(); });
+		}
+		~zout_pool() {
+			{
+				std::unique_lock<std::mutex> lock(m);
+				stop = true;
+				cv.notify_all();
+			}
+			for(std::thread& t : threads) t.join();
+		}
+		zout_pool(const zout_pool&) = delete;
+		zout_pool& operator = (const zout_pool&) = delete;
+
+		void submit(std::function<void()>&& f) {
+			std::unique_lock<std::mutex> lock(m);
+			jobs.push_back(std::move(f));
+			cv.notify_one();
+		}
+		size_t size() const { return threads.size(); }
+
+		/* pool shared by all output streams by default */
+		static zout_pool& get() {
+			static zout_pool pool;
+			return pool;
+		}
+
+	protected:
+		void run() {
+			while(true) {
+				std::function<void()> f;
+				{
+					std::unique_lock<std::mutex> lock(m);
+					cv.wait(lock, [this]() { return stop || !jobs.empty(); });
+					if(jobs.empty()) return;
+					f = std::move(jobs.front());
+					jobs.pop_front();
+				}
+				f();
+			}
+		}
+		std::vector<std::thread> threads;
+		std::deque<std::function<void()> > jobs;
+		std::mutex m;
+		std::condition_variable cv;
+		bool stop = false;
+};
+
+class zout {
+	public:
+		/* open the given file (stdout if fn == 0) for writing in the given format;
+		 * level is the compression level (0: default); returns 0 on error */
+		static zout* open(const char* fn, int format, int level = 0, zout_pool* pool = 0) {
+#ifndef ZFILE_ZSTD
+			if(format == ZOUT_ZSTD) {
+				fprintf(stderr,"zout::open(): zstd output is not supported (compile with -DZFILE_ZSTD)!\n");
+				return 0;
+			}
+#endif
+			FILE* f = fn ? fopen(fn,"w") : stdout;
+			if(!f) return 0;
+			return init(f, format, level, pool);
+		}
+
+		/* continue writing a file written earlier (e.g. when resuming from a
+		 * checkpoint, see checkpoint() below): the file is truncated to pos,
+		 * and the len bytes in data are put in the current block; returns 0 on error */
+		static zout* open_at(const char* fn, int format, uint64_t pos, const char* data, size_t len,
+				int level = 0, zout_pool* pool = 0) {
+#ifndef ZFILE_ZSTD
+			if(format == ZOUT_ZSTD) return 0;
+#endif
+			if(len > ZOUT_BLOCK) return 0;
+			FILE* f = fopen(fn,"r+");
+			if(!f) return 0;
+			if(ftruncate(fileno(f), pos) || fseeko(f, pos, SEEK_SET)) {
+				fclose(f);
+				return 0;
+			}
+			zout* z = init(f, format, level, pool);
+			if(pos) z->nblocks = 1; /* the file already has a header */
+			memcpy(z->cur, data, len);
+			z->cur_len = len;
+			return z;
+		}
+
+		/* write out everything and close the file (except stdout, which is only
+		 * flushed), and delete this object; returns 0 on success */
+		int close() {
+			/* an empty compressed file still needs a (gzip / zstd) header */
+			if(cur_len || (!nblocks && format != ZOUT_PLAIN)) send_block();
+			{
+				std::unique_lock<std::mutex> lock(m);
+				cv.wait(lock, [this]() { return pending.empty(); });
+			}
+			int ret = err ? 1 : 0;
+			if(f == stdout) { if(fflush(f)) ret = 1; }
+			else if(fclose(f)) ret = 1;
+			delete this;
+			return ret;
+		}
+
+		/* write out all full blocks that were sent for compression and flush the
+		 * file, so that it can be used to resume later with open_at(); *pos is set
+		 * to the size of the file, *data and *len to the contents of the current
+		 * block (valid until the next write); returns 0 on success */
+		int checkpoint(uint64_t* pos, const char** data, size_t* len) {
+			{
+				std::unique_lock<std::mutex> lock(m);
+				cv.wait(lock, [this]() { return pending.empty(); });
+			}
+			if(err || fflush(f)) return 1;
+			off_t p = ftello(f);
+			if(p < 0) return 1;
+			*pos = p;
+			*data = cur;
+			*len = cur_len;
+			return 0;
+		}
+
+		void put(char c) {
+			cur[cur_len++] = c;
+			check();
+		}
+		void write(const char* s, size_t len) {
+			while(len) {
+				size_t n = ZOUT_BLOCK + ZOUT_SLACK - cur_len;
+				if(n > len) n = len;
+				memcpy(cur + cur_len, s, n);
+				cur_len += n;
+				s += n;
+				len -= n;
+				check();
+			}
+		}
+		void write(const char* s) { write(s, strlen(s)); }
+
+		void write_uint(uint64_t x) {
+			char tmp[24];
+			char* p = tmp + sizeof(tmp);
+			do {
+				*(--p) = '0' + (x % 10);
+				x /= 10;
+			} while(x);
+			size_t n = tmp + sizeof(tmp) - p;
+			memcpy(cur + cur_len, p, n);
+			cur_len += n;
+			check();
+		}
+		void write_int(int64_t x) {
+			if(x < 0) {
+				cur[cur_len++] = '-';
+				write_uint(-(uint64_t)x);
+			}
+			else write_uint(x);
+		}
+
+		/* same output as printf("%g",x) */
+		void write_g(double x) {
+			/* the result is calculated as six digits (with the exponent e), by scaling
+			 * with an exact power of ten in long double precision; in the rare case
+			 * when this is too close to a tie for rounding, or outside the range of
+			 * exact powers of ten, snprintf() is used instead */
+			if(x == 0.0 || !isfinite(x)) { printf("%g", x); return; }
+			bool neg = (x < 0.0);
+			long double y = neg ? -x : x;
+			int e = (int)floor(log10((double)y));
+			long double s = 0.0L;
+			uint64_t v = 0;
+			for(int k=0;k<2;k++) {
+				int p10 = 5 - e;
+				if(p10 > 27 || p10 < -27) { printf("%g", x); return; }
+				s = (p10 >= 0) ? y * zout_pow10(p10) : y / zout_pow10(-p10);
+				if(s < 100000.0L) e--;
+				else if(s >= 1000000.0L) e++;
+				else break;
+			}
+			if(s < 100000.0L || s >= 1000000.0L) { printf("%g", x); return; }
+			v = (uint64_t)s;
+			long double frac = s - (long double)v;
+			if(fabsl(frac - 0.5L) < 1e-9L) { printf("%g", x); return; }
+			if(frac > 0.5L) v++;
+			if(v == 1000000) { v = 100000; e++; }
+
+			char d[6];
+			for(int i=5;i>=0;i--) { d[i] = '0' + (v % 10); v /= 10; }
+			int nd = 6; /* number of digits after removing trailing zeros */
+			while(nd > 1 && d[nd-1] == '0') nd--;
+			if(neg) cur[cur_len++] = '-';
+			if(e >= -4 && e < 6) {
+				if(e >= 0) {
+					memcpy(cur + cur_len, d, e+1);
+					cur_len += e+1;
+					if(nd > e+1) {
+						cur[cur_len++] = '.';
+						memcpy(cur + cur_len, d + e + 1, nd - e - 1);
+						cur_len += nd - e - 1;
+					}
+				}
+				else {
+					cur[cur_len++] = '0';
+					cur[cur_len++] = '.';
+					for(int i=0;i<-e-1;i++) cur[cur_len++] = '0';
+					memcpy(cur + cur_len, d, nd);
+					cur_len += nd;
+				}
+			}
+			else {
+				cur[cur_len++] = d[0];
+				if(nd > 1) {
+					cur[cur_len++] = '.';
+					memcpy(cur + cur_len, d + 1, nd - 1);
+					cur_len += nd - 1;
+				}
+				cur[cur_len++] = 'e';
+				cur[cur_len++] = (e < 0) ? '-' : '+';
+				unsigned int ae = (e < 0) ? -e : e;
+				if(ae < 10) cur[cur_len++] = '0';
+				write_uint(ae);
+				return;
+			}
+			check();
+		}
+
+		/* general formatted output (slower, for less frequently used formats) */
+		__attribute__ ((format (printf, 2, 3))) void printf(const char* fmt, ...) {
+			va_list ap;
+			va_start(ap, fmt);
+			int n = vsnprintf(cur + cur_len, ZOUT_SLACK, fmt, ap);
+			va_end(ap);
+			if(n < 0) { err = true; return; }
+			if(n < ZOUT_SLACK) cur_len += n;
+			else {
+				std::vector<char> tmp(n+1);
+				va_start(ap, fmt);
+				vsnprintf(tmp.data(), n+1, fmt, ap);
+				va_end(ap);
+				write(tmp.data(), n);
+				return;
+			}
+			check();
+		}
+
+	protected:
+		struct block {
+			std::vector<char> data;
+			size_t len = 0;
+			std::vector<char> out; /* compressed data */
+			bool done = false;
+		};
+
+		FILE* f = 0;
+		int format = ZOUT_PLAIN;
+		int level = 0;
+		zout_pool* pool = 0;
+		size_t max_pending = 0;
+		uint64_t nblocks = 0; /* number of blocks sent for compression */
+		std::unique_ptr<block> b; /* block being filled */
+		char* cur = 0; /* its data */
+		size_t cur_len = 0;
+		std::deque<std::unique_ptr<block> > pending; /* blocks being compressed / written, in order */
+		bool writing = false; /* a thread is writing out blocks */
+		bool err = false;
+		std::mutex m;
+		std::condition_variable cv;
+
+		zout() { }
+		~zout() { }
+		zout(const zout&) = delete;
+		zout& operator = (const zout&) = delete;
+
+		static zout* init(FILE* f, int format, int level, zout_pool* pool) {
+			zout* z = new zout;
+			z->f = f;
+			z->format = format;
+			z->level = level ? level : (format == ZOUT_ZSTD ? 3 : Z_DEFAULT_COMPRESSION);
+			z->pool = pool ? pool : &zout_pool::get();
+			z->max_pending = 2*z->pool->size() + 2;
+			z->new_block();
+			return z;
+		}
+
+		static long double zout_pow10(int k) {
+			long double r = 1.0L;
+			for(int i=0;i<k;i++) r *= 10.0L; /* exact for k <= 27 */
+			return r;
+		}
+
+		void new_block() {
+			b.reset(new block);
+			b->data.resize(ZOUT_BLOCK + ZOUT_SLACK);
+			cur = b->data.data();
+			cur_len = 0;
+		}
+		void check() {
+			if(cur_len >= ZOUT_BLOCK) send_block();
+		}
+
+		/* compress the block (called from one of the threads in the pool);
+		 * returns true on success */
+		bool compress(block* b1) {
+			bool ret = true;
+			switch(format) {
+				case ZOUT_GZIP:
+					{
+						z_stream zs;
+						memset(&zs, 0, sizeof(z_stream));
+						if(deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+							ret = false;
+							break;
+						}
+						b1->out.resize(deflateBound(&zs, b1->len));
+						zs.next_in = (Bytef*)b1->data.data();
+						zs.avail_in = b1->len;
+						zs.next_out = (Bytef*)b1->out.data();
+						zs.avail_out = b1->out.size();
+						if(deflate(&zs, Z_FINISH) != Z_STREAM_END) ret = false;
+						b1->out.resize(b1->out.size() - zs.avail_out);
+						deflateEnd(&zs);
+					}
+					break;
+#ifdef ZFILE_ZSTD
+				case ZOUT_ZSTD:
+					{
+						b1->out.resize(ZSTD_compressBound(b1->len));
+						size_t r = ZSTD_compress(b1->out.data(), b1->out.size(), b1->data.data(), b1->len, level);
+						if(ZSTD_isError(r)) { ret = false; r = 0; }
+						b1->out.resize(r);
+					}
+					break;
+#endif
+				default:
+					break;
+			}
+			if(format != ZOUT_PLAIN) std::vector<char>().swap(b1->data);
+			return ret;
+		}
+
+		/* write out the blocks that are ready, in order (only one thread does this at a time) */
+		void write_ready(std::unique_lock<std::mutex>& lock) {
+			if(writing) return;
+			writing = true;
+			while(!pending.empty() && pending.front()->done) {
+				block* b1 = pending.front().get();
+				lock.unlock();
+				const std::vector<char>& out = (format == ZOUT_PLAIN) ? b1->data : b1->out;
+				size_t len = (format == ZOUT_PLAIN) ? b1->len : out.size();
+				bool e1 = (len && fwrite(out.data(), 1, len, f) != len);
+				lock.lock();
+				if(e1) err = true;
+				pending.pop_front();
+				cv.notify_all();
+			}
+			writing = false;
+		}
+
+		void send_block() {
+			b->len = cur_len;
+			block* b1 = b.get();
+			{
+				std::unique_lock<std::mutex> lock(m);
+				cv.wait(lock, [this]() { return pending.size() < max_pending; });
+				pending.push_back(std::move(b));
+			}
+			nblocks++;
+			pool->submit([this,b1]() {
+				bool ok = compress(b1);
+				std::unique_lock<std::mutex> lock(m);
+				if(!ok) err = true;
+				b1->done = true;
+				write_ready(lock);
+			});
+			new_block();
+		}
+};
+
+#endif
+